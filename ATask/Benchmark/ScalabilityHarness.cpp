@@ -0,0 +1,725 @@
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <utility>
+#include "ScalabilityHarness.h"
+#include "../HAL/Event.h"
+#include "../TaskGraph/IncrementalTaskGraph.h"
+#include "../TaskGraph/StaticTaskGraph.h"
+#include "../Thread/Future.h"
+#include "../Thread/IQueuedWork.h"
+#include "../Thread/QueuedThreadPool.h"
+#include "../Thread/ThreadManager.h"
+
+namespace
+{
+	/** Duration of a tiny task in seconds. */
+	const double TinyTaskSeconds = 2e-6;
+
+	/** Heavy tailed durations follow a Pareto distribution with this scale and shape, capped to the maximum. */
+	const double ParetoScaleSeconds = 1e-6;
+	const double ParetoShape = 1.5;
+	const double ParetoMaxSeconds = 2e-3;
+
+	/** Every BlockingInterval-th task of the mixed workload sleeps this long. */
+	const uint32 BlockingInterval = 16;
+	const float BlockingSeconds = 0.001f;
+
+	/** The number of independent chains and fan-out roots, fixed so every worker count runs the same work. */
+	const uint32 NumChains = 16;
+	const uint32 NumFanOutRoots = 16;
+
+	/**
+	* The graph workloads have a compile time shape, their graphs execute repeatedly
+	* to run about as many tasks as the others. Chain N is nodes N * GraphChainLength
+	* to (N + 1) * GraphChainLength - 1, the fan-out roots are the first nodes and the
+	* children of root N follow them in groups of GraphFanOut.
+	*/
+	const int32 NumGraphChains = 16;
+	const int32 GraphChainLength = 16;
+	const int32 NumGraphFanOutRoots = 16;
+	const int32 GraphFanOut = 16;
+
+	template<typename EdgeIndexSequence>
+	struct TChainsLayout;
+
+	template<size_t... EdgeIndex>
+	struct TChainsLayout<std::index_sequence<EdgeIndex...>>
+	{
+		typedef TStaticTaskGraphLayout<NumGraphChains * GraphChainLength,
+			TStaticTaskEdge<(int32)(EdgeIndex / (GraphChainLength - 1) * GraphChainLength + EdgeIndex % (GraphChainLength - 1)),
+				(int32)(EdgeIndex / (GraphChainLength - 1) * GraphChainLength + EdgeIndex % (GraphChainLength - 1) + 1)>...> Type;
+	};
+
+	template<typename EdgeIndexSequence>
+	struct TFanOutLayout;
+
+	template<size_t... EdgeIndex>
+	struct TFanOutLayout<std::index_sequence<EdgeIndex...>>
+	{
+		typedef TStaticTaskGraphLayout<NumGraphFanOutRoots * (GraphFanOut + 1),
+			TStaticTaskEdge<(int32)(EdgeIndex / GraphFanOut), (int32)(NumGraphFanOutRoots + EdgeIndex)>...> Type;
+	};
+
+	typedef TChainsLayout<std::make_index_sequence<NumGraphChains * (GraphChainLength - 1)>>::Type FChainsLayout;
+	typedef TFanOutLayout<std::make_index_sequence<NumGraphFanOutRoots * GraphFanOut>>::Type FFanOutLayout;
+
+	void SpinFor(double Seconds)
+	{
+		const uint64 EndCycles = FPlatformTime::Cycles64() + (uint64)(Seconds / FPlatformTime::GetSecondsPerCycle64());
+		while (FPlatformTime::Cycles64() < EndCycles)
+		{
+		}
+	}
+
+	double CyclesToSeconds(uint64 Cycles)
+	{
+		return (double)Cycles * FPlatformTime::GetSecondsPerCycle64();
+	}
+
+	/**
+	* Shared state of a run: counts down the outstanding tasks and wakes the
+	* harness once the last one finished.
+	*/
+	struct FRunContext
+	{
+		std::atomic<uint32> NumRemaining;
+		FEvent* DoneEvent;
+		std::vector<double> Latencies;
+
+		FRunContext(uint32 NumTasks, uint32 NumCompletions)
+			: NumRemaining(NumCompletions)
+			, DoneEvent(FPlatformProcess::CreateSynchEvent(true))
+			, Latencies(NumTasks, 0.0)
+		{}
+
+		~FRunContext()
+		{
+			delete DoneEvent;
+		}
+
+		void CompleteOne()
+		{
+			if (NumRemaining.fetch_sub(1) == 1)
+			{
+				DoneEvent->Trigger();
+			}
+		}
+
+		void Wait()
+		{
+			if (FPlatformProcess::SupportsMultithreading())
+			{
+				DoneEvent->Wait();
+				return;
+			}
+			// Without multithreading the pool only makes progress while this thread ticks it
+			while (NumRemaining.load() != 0)
+			{
+				FThreadManager::Get().Tick();
+			}
+		}
+	};
+
+	double Percentile(const std::vector<double>& SortedValues, double Fraction)
+	{
+		if (SortedValues.empty())
+		{
+			return 0.0;
+		}
+		const size_t Index = std::min(SortedValues.size() - 1, (size_t)(Fraction * (double)SortedValues.size()));
+		return SortedValues[Index];
+	}
+
+	/**
+	* Times the nodes of a graph workload. Every node has at most one prerequisite, its latency
+	* is the time from that finishing, or from the start of the execution for a root, until it starts.
+	*/
+	struct FGraphTiming
+	{
+		/** The prerequisite of every node, INDEX_NONE for roots. */
+		std::vector<int32> Prerequisites;
+		std::vector<uint64> EndCycles;
+		uint64 ExecutionStartCycles;
+
+		/** Where the current execution records the latencies, indexed by node. */
+		double* Latencies;
+
+		explicit FGraphTiming(std::vector<int32> InPrerequisites)
+			: Prerequisites(std::move(InPrerequisites))
+			, EndCycles(Prerequisites.size(), 0)
+			, ExecutionStartCycles(0)
+			, Latencies(nullptr)
+		{}
+
+		int32 GetNumNodes() const
+		{
+			return (int32)Prerequisites.size();
+		}
+
+		void RunNode(int32 Node)
+		{
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+			const int32 Prerequisite = Prerequisites[Node];
+			Latencies[Node] = CyclesToSeconds(StartCycles - (Prerequisite == INDEX_NONE ? ExecutionStartCycles : EndCycles[Prerequisite]));
+			SpinFor(TinyTaskSeconds);
+			EndCycles[Node] = FPlatformTime::Cycles64();
+		}
+
+		/** Executes the graph NumExecutions times, recording the latencies, and returns the seconds it took. */
+		template<typename ExecuteType>
+		double Run(uint32 NumExecutions, std::vector<double>& OutLatencies, ExecuteType Execute)
+		{
+			OutLatencies.assign((size_t)NumExecutions * Prerequisites.size(), 0.0);
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+			for (uint32 Execution = 0; Execution < NumExecutions; Execution++)
+			{
+				Latencies = &OutLatencies[(size_t)Execution * Prerequisites.size()];
+				ExecutionStartCycles = FPlatformTime::Cycles64();
+				Execute();
+			}
+			return CyclesToSeconds(FPlatformTime::Cycles64() - StartCycles);
+		}
+	};
+
+	std::vector<int32> MakeChainPrerequisites()
+	{
+		std::vector<int32> Prerequisites(NumGraphChains * GraphChainLength);
+		for (int32 Node = 0; Node < (int32)Prerequisites.size(); Node++)
+		{
+			Prerequisites[Node] = Node % GraphChainLength == 0 ? INDEX_NONE : Node - 1;
+		}
+		return Prerequisites;
+	}
+
+	std::vector<int32> MakeFanOutPrerequisites()
+	{
+		std::vector<int32> Prerequisites(NumGraphFanOutRoots * (GraphFanOut + 1));
+		for (int32 Node = 0; Node < (int32)Prerequisites.size(); Node++)
+		{
+			Prerequisites[Node] = Node < NumGraphFanOutRoots ? INDEX_NONE : (Node - NumGraphFanOutRoots) / GraphFanOut;
+		}
+		return Prerequisites;
+	}
+
+	template<typename LayoutType>
+	double RunStaticGraph(FQueuedThreadPool* ThreadPool, FGraphTiming& Timing, uint32 NumExecutions, std::vector<double>& OutLatencies)
+	{
+		assert(LayoutType::NumNodes == Timing.GetNumNodes());
+		// Kept off the stack, the graph holds all of its nodes inline
+		TStaticTaskGraph<LayoutType>* Graph = new TStaticTaskGraph<LayoutType>(ThreadPool);
+		FGraphTiming* TimingPtr = &Timing;
+		for (int32 Node = 0; Node < LayoutType::NumNodes; Node++)
+		{
+			Graph->SetTask(Node, [TimingPtr, Node]()
+			{
+				TimingPtr->RunNode(Node);
+			});
+		}
+		const double Seconds = Timing.Run(NumExecutions, OutLatencies, [Graph]()
+		{
+			Graph->Execute();
+		});
+		delete Graph;
+		return Seconds;
+	}
+
+	double RunIncrementalGraph(FQueuedThreadPool* ThreadPool, FGraphTiming& Timing, uint32 NumExecutions, std::vector<double>& OutLatencies)
+	{
+		FIncrementalTaskGraph Graph(ThreadPool);
+		FGraphTiming* TimingPtr = &Timing;
+		// Every node outputs the generation, so a re-execution from the dirty roots recomputes all nodes
+		uint64 Generation = 0;
+		uint64* GenerationPtr = &Generation;
+		std::vector<FIncrementalTaskGraph::FNodeId> Roots;
+		for (int32 Node = 0; Node < Timing.GetNumNodes(); Node++)
+		{
+			Graph.AddNode([TimingPtr, GenerationPtr, Node]() -> uint64
+			{
+				TimingPtr->RunNode(Node);
+				return *GenerationPtr;
+			});
+			if (Timing.Prerequisites[Node] == INDEX_NONE)
+			{
+				Roots.push_back(Node);
+			}
+			else
+			{
+				Graph.AddDependency(Timing.Prerequisites[Node], Node);
+			}
+		}
+
+		// Only re-executions are timed, the first one computes the new nodes
+		std::vector<double> FirstLatencies;
+		Timing.Run(1, FirstLatencies, [&Graph]()
+		{
+			Graph.Execute();
+		});
+		return Timing.Run(NumExecutions, OutLatencies, [&Graph, &Roots, &Generation]()
+		{
+			Generation++;
+			for (FIncrementalTaskGraph::FNodeId Root : Roots)
+			{
+				Graph.MarkDirty(Root);
+			}
+			Graph.Execute();
+		});
+	}
+
+	/** @return The mask of the NumProcessors lowest processors of AvailableMask, all of them if there are fewer. */
+	uint64 GetLowestProcessors(uint64 AvailableMask, int32 NumProcessors)
+	{
+		uint64 Mask = 0;
+		for (int32 Bit = 0; Bit < 64 && NumProcessors > 0; ++Bit)
+		{
+			const uint64 Processor = (uint64)1 << Bit;
+			if (AvailableMask & Processor)
+			{
+				Mask |= Processor;
+				--NumProcessors;
+			}
+		}
+		return Mask;
+	}
+
+	struct FBaseline
+	{
+		std::string Workload;
+		int32 NumWorkers;
+		double Throughput;
+		double P99Us;
+	};
+}
+
+FScalabilityHarness::FScalabilityHarness(const FScalabilityOptions& InOptions)
+	: Options(InOptions)
+{
+	if (Options.TasksPerRun < NumChains * 2)
+	{
+		Options.TasksPerRun = NumChains * 2;
+	}
+	if (Options.Repetitions == 0)
+	{
+		Options.Repetitions = 1;
+	}
+	if (Options.WorkerStep < 1)
+	{
+		Options.WorkerStep = 1;
+	}
+}
+
+std::vector<int32> FScalabilityHarness::GetWorkerCounts() const
+{
+	// The affinity mask has one bit per processor
+	int32 MaxWorkers = std::min<int32>(FPlatformProcess::NumberOfCores(), 64);
+	if (Options.MaxWorkers > 0)
+	{
+		MaxWorkers = std::min(MaxWorkers, Options.MaxWorkers);
+	}
+	MaxWorkers = std::max(MaxWorkers, 1);
+
+	// Every count by default, scaling cliffs are not limited to powers of two
+	std::vector<int32> WorkerCounts;
+	for (int32 NumWorkers = 1; NumWorkers < MaxWorkers; NumWorkers += Options.WorkerStep)
+	{
+		WorkerCounts.push_back(NumWorkers);
+	}
+	WorkerCounts.push_back(MaxWorkers);
+	return WorkerCounts;
+}
+
+int32 FScalabilityHarness::Run(std::ostream& Out)
+{
+	static const FWorkload Workloads[] =
+	{
+		{ "uniform", &FScalabilityHarness::RunUniform },
+		{ "heavytail", &FScalabilityHarness::RunHeavyTailed },
+		{ "chain", &FScalabilityHarness::RunChains },
+		{ "fanout", &FScalabilityHarness::RunFanOut },
+		{ "mixed", &FScalabilityHarness::RunMixedBlocking },
+		{ "graphchain", &FScalabilityHarness::RunGraphChains },
+		{ "graphfanout", &FScalabilityHarness::RunGraphFanOut },
+		{ "incchain", &FScalabilityHarness::RunIncrementalChains },
+		{ "incfanout", &FScalabilityHarness::RunIncrementalFanOut },
+	};
+	const size_t NumWorkloads = sizeof(Workloads) / sizeof(Workloads[0]);
+
+	Results.clear();
+	std::vector<double> SingleWorkerThroughput(NumWorkloads, 0.0);
+
+	Out << std::left << std::setw(12) << "workload" << std::right
+		<< std::setw(8) << "workers" << std::setw(14) << "tasks/s"
+		<< std::setw(10) << "p50us" << std::setw(10) << "p99us" << std::setw(10) << "p999us"
+		<< std::setw(8) << "eff" << std::endl;
+
+	// The sweep narrows the processors the process may use, restored once it is done
+	const uint64 ProcessAffinityMask = FPlatformProcess::GetProcessAffinityMask();
+	for (int32 NumWorkers : GetWorkerCounts())
+	{
+		// Keep the pool and the harness on as many processors as there are workers
+		FPlatformProcess::SetProcessAffinityMask(GetLowestProcessors(ProcessAffinityMask, NumWorkers));
+
+		FQueuedThreadPool* ThreadPool = FQueuedThreadPool::Allocate();
+		if (!ThreadPool->Create((uint32_t)NumWorkers))
+		{
+			Out << "Failed to create a pool with " << NumWorkers << " workers" << std::endl;
+			delete ThreadPool;
+			break;
+		}
+
+		for (size_t WorkloadIndex = 0; WorkloadIndex < NumWorkloads; WorkloadIndex++)
+		{
+			const FWorkload& Workload = Workloads[WorkloadIndex];
+
+			// Report the fastest repetition, the others are most likely disturbed by the system
+			FRunSample Best;
+			Best.Seconds = 0.0;
+			for (uint32 Repetition = 0; Repetition < Options.Repetitions; Repetition++)
+			{
+				FRunSample Sample = (this->*Workload.Function)(ThreadPool, NumWorkers);
+				if (Best.Seconds == 0.0 || Sample.Seconds < Best.Seconds)
+				{
+					Best = std::move(Sample);
+				}
+			}
+			std::sort(Best.Latencies.begin(), Best.Latencies.end());
+
+			FScalabilityResult Result;
+			Result.Workload = Workload.Name;
+			Result.NumWorkers = NumWorkers;
+			Result.Throughput = Best.Seconds > 0.0 ? (double)Best.Latencies.size() / Best.Seconds : 0.0;
+			Result.P50Us = Percentile(Best.Latencies, 0.5) * 1e6;
+			Result.P99Us = Percentile(Best.Latencies, 0.99) * 1e6;
+			Result.P999Us = Percentile(Best.Latencies, 0.999) * 1e6;
+			if (NumWorkers == 1)
+			{
+				SingleWorkerThroughput[WorkloadIndex] = Result.Throughput;
+			}
+			if (SingleWorkerThroughput[WorkloadIndex] > 0.0)
+			{
+				Result.Efficiency = Result.Throughput / (SingleWorkerThroughput[WorkloadIndex] * NumWorkers);
+			}
+			Results.push_back(Result);
+
+			Out << std::left << std::setw(12) << Result.Workload << std::right
+				<< std::setw(8) << Result.NumWorkers
+				<< std::fixed << std::setprecision(0) << std::setw(14) << Result.Throughput
+				<< std::setprecision(1) << std::setw(10) << Result.P50Us << std::setw(10) << Result.P99Us << std::setw(10) << Result.P999Us
+				<< std::setprecision(2) << std::setw(8) << Result.Efficiency << std::endl;
+		}
+
+		ThreadPool->Destory();
+		delete ThreadPool;
+	}
+	FPlatformProcess::SetProcessAffinityMask(ProcessAffinityMask);
+
+	if (Options.BaselineFile.empty())
+	{
+		Out << "No baselines given, the results were not compared, pass -baseline=File to gate on them" << std::endl;
+		return 0;
+	}
+	if (Options.bWriteBaseline)
+	{
+		if (!WriteBaselines())
+		{
+			Out << "Failed to write baselines to " << Options.BaselineFile << std::endl;
+			return 1;
+		}
+		Out << "Wrote baselines to " << Options.BaselineFile << std::endl;
+		return 0;
+	}
+	return CompareBaselines(Out);
+}
+
+FScalabilityHarness::FRunSample FScalabilityHarness::RunIndependent(FQueuedThreadPool* ThreadPool, const std::vector<double>& Durations, uint32 InBlockingInterval)
+{
+	const uint32 NumTasks = (uint32)Durations.size();
+	FRunContext Context(NumTasks, NumTasks);
+
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	for (uint32 Index = 0; Index < NumTasks; Index++)
+	{
+		const uint64 QueuedCycles = FPlatformTime::Cycles64();
+		const double Duration = Durations[Index];
+		const bool bBlocking = InBlockingInterval != 0 && Index % InBlockingInterval == 0;
+		FRunContext* ContextPtr = &Context;
+		ThreadPool->QueuedThreadWork(new FFunctionQueuedWork([ContextPtr, Index, QueuedCycles, Duration, bBlocking]()
+		{
+			if (bBlocking)
+			{
+				FPlatformProcess::Sleep(BlockingSeconds);
+			}
+			else
+			{
+				SpinFor(Duration);
+			}
+			ContextPtr->Latencies[Index] = CyclesToSeconds(FPlatformTime::Cycles64() - QueuedCycles);
+			ContextPtr->CompleteOne();
+		}), true);
+	}
+	Context.Wait();
+
+	FRunSample Sample;
+	Sample.Seconds = CyclesToSeconds(FPlatformTime::Cycles64() - StartCycles);
+	Sample.Latencies = std::move(Context.Latencies);
+	return Sample;
+}
+
+FScalabilityHarness::FRunSample FScalabilityHarness::RunUniform(FQueuedThreadPool* ThreadPool, int32 NumWorkers)
+{
+	return RunIndependent(ThreadPool, std::vector<double>(Options.TasksPerRun, TinyTaskSeconds), 0);
+}
+
+FScalabilityHarness::FRunSample FScalabilityHarness::RunHeavyTailed(FQueuedThreadPool* ThreadPool, int32 NumWorkers)
+{
+	// Same seed for every run so the worker counts are compared on the same durations
+	std::mt19937 Random(42);
+	std::uniform_real_distribution<double> Uniform(1e-9, 1.0);
+	std::vector<double> Durations(Options.TasksPerRun);
+	for (double& Duration : Durations)
+	{
+		Duration = std::min(ParetoMaxSeconds, ParetoScaleSeconds / std::pow(Uniform(Random), 1.0 / ParetoShape));
+	}
+	return RunIndependent(ThreadPool, Durations, 0);
+}
+
+FScalabilityHarness::FRunSample FScalabilityHarness::RunMixedBlocking(FQueuedThreadPool* ThreadPool, int32 NumWorkers)
+{
+	return RunIndependent(ThreadPool, std::vector<double>(Options.TasksPerRun, TinyTaskSeconds), BlockingInterval);
+}
+
+FScalabilityHarness::FRunSample FScalabilityHarness::RunChains(FQueuedThreadPool* ThreadPool, int32 NumWorkers)
+{
+	// The latency of a link is the time from its predecessor finishing until it starts
+	const uint32 ChainLength = Options.TasksPerRun / NumChains;
+	FRunContext Context(ChainLength * NumChains, NumChains);
+	FRunContext* ContextPtr = &Context;
+
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	for (uint32 Chain = 0; Chain < NumChains; Chain++)
+	{
+		const uint32 FirstIndex = Chain * ChainLength;
+		TFuture<uint64> Link = Async([ContextPtr, FirstIndex, StartCycles]()
+		{
+			ContextPtr->Latencies[FirstIndex] = CyclesToSeconds(FPlatformTime::Cycles64() - StartCycles);
+			SpinFor(TinyTaskSeconds);
+			return FPlatformTime::Cycles64();
+		}, ThreadPool);
+		for (uint32 Index = FirstIndex + 1; Index < FirstIndex + ChainLength; Index++)
+		{
+			Link = Link.Then([ContextPtr, Index](uint64 PrevEndCycles)
+			{
+				ContextPtr->Latencies[Index] = CyclesToSeconds(FPlatformTime::Cycles64() - PrevEndCycles);
+				SpinFor(TinyTaskSeconds);
+				return FPlatformTime::Cycles64();
+			});
+		}
+		Link.Then([ContextPtr](uint64)
+		{
+			ContextPtr->CompleteOne();
+		});
+	}
+	Context.Wait();
+
+	FRunSample Sample;
+	Sample.Seconds = CyclesToSeconds(FPlatformTime::Cycles64() - StartCycles);
+	Sample.Latencies = std::move(Context.Latencies);
+	return Sample;
+}
+
+FScalabilityHarness::FRunSample FScalabilityHarness::RunFanOut(FQueuedThreadPool* ThreadPool, int32 NumWorkers)
+{
+	// Every root spawns its children from a pool thread and joins them without blocking
+	const uint32 FanOut = Options.TasksPerRun / NumFanOutRoots;
+	FRunContext Context(FanOut * NumFanOutRoots, NumFanOutRoots);
+	FRunContext* ContextPtr = &Context;
+
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	for (uint32 Root = 0; Root < NumFanOutRoots; Root++)
+	{
+		const uint32 FirstIndex = Root * FanOut;
+		Async([ContextPtr, ThreadPool, FirstIndex, FanOut]()
+		{
+			std::vector<TFuture<void>> Children;
+			Children.reserve(FanOut);
+			for (uint32 Index = FirstIndex; Index < FirstIndex + FanOut; Index++)
+			{
+				const uint64 SpawnCycles = FPlatformTime::Cycles64();
+				Children.push_back(Async([ContextPtr, Index, SpawnCycles]()
+				{
+					SpinFor(TinyTaskSeconds);
+					ContextPtr->Latencies[Index] = CyclesToSeconds(FPlatformTime::Cycles64() - SpawnCycles);
+				}, ThreadPool));
+			}
+			WhenAll(Children).Then([ContextPtr]()
+			{
+				ContextPtr->CompleteOne();
+			});
+		}, ThreadPool);
+	}
+	Context.Wait();
+
+	FRunSample Sample;
+	Sample.Seconds = CyclesToSeconds(FPlatformTime::Cycles64() - StartCycles);
+	Sample.Latencies = std::move(Context.Latencies);
+	return Sample;
+}
+
+FScalabilityHarness::FRunSample FScalabilityHarness::RunGraphChains(FQueuedThreadPool* ThreadPool, int32 NumWorkers)
+{
+	FGraphTiming Timing(MakeChainPrerequisites());
+	FRunSample Sample;
+	Sample.Seconds = RunStaticGraph<FChainsLayout>(ThreadPool, Timing, GetNumGraphExecutions(Timing.GetNumNodes()), Sample.Latencies);
+	return Sample;
+}
+
+FScalabilityHarness::FRunSample FScalabilityHarness::RunGraphFanOut(FQueuedThreadPool* ThreadPool, int32 NumWorkers)
+{
+	FGraphTiming Timing(MakeFanOutPrerequisites());
+	FRunSample Sample;
+	Sample.Seconds = RunStaticGraph<FFanOutLayout>(ThreadPool, Timing, GetNumGraphExecutions(Timing.GetNumNodes()), Sample.Latencies);
+	return Sample;
+}
+
+FScalabilityHarness::FRunSample FScalabilityHarness::RunIncrementalChains(FQueuedThreadPool* ThreadPool, int32 NumWorkers)
+{
+	FGraphTiming Timing(MakeChainPrerequisites());
+	FRunSample Sample;
+	Sample.Seconds = RunIncrementalGraph(ThreadPool, Timing, GetNumGraphExecutions(Timing.GetNumNodes()), Sample.Latencies);
+	return Sample;
+}
+
+FScalabilityHarness::FRunSample FScalabilityHarness::RunIncrementalFanOut(FQueuedThreadPool* ThreadPool, int32 NumWorkers)
+{
+	FGraphTiming Timing(MakeFanOutPrerequisites());
+	FRunSample Sample;
+	Sample.Seconds = RunIncrementalGraph(ThreadPool, Timing, GetNumGraphExecutions(Timing.GetNumNodes()), Sample.Latencies);
+	return Sample;
+}
+
+uint32 FScalabilityHarness::GetNumGraphExecutions(int32 NumNodes) const
+{
+	return std::max<uint32>(1, Options.TasksPerRun / (uint32)NumNodes);
+}
+
+int32 FScalabilityHarness::CompareBaselines(std::ostream& Out) const
+{
+	// A gate without baselines would pass whatever the results are
+	std::ifstream File(Options.BaselineFile);
+	if (!File)
+	{
+		Out << "No baselines at " << Options.BaselineFile << ", write them with -writebaseline first" << std::endl;
+		return 1;
+	}
+
+	std::vector<FBaseline> Baselines;
+	std::string Line;
+	while (std::getline(File, Line))
+	{
+		if (Line.empty() || Line[0] == '#')
+		{
+			continue;
+		}
+		std::istringstream Stream(Line);
+		FBaseline Baseline;
+		if (Stream >> Baseline.Workload >> Baseline.NumWorkers >> Baseline.Throughput >> Baseline.P99Us)
+		{
+			Baselines.push_back(Baseline);
+		}
+	}
+
+	int32 NumRegressions = 0;
+	for (const FScalabilityResult& Result : Results)
+	{
+		auto Found = std::find_if(Baselines.begin(), Baselines.end(), [&Result](const FBaseline& Baseline)
+		{
+			return Baseline.Workload == Result.Workload && Baseline.NumWorkers == Result.NumWorkers;
+		});
+		if (Found == Baselines.end())
+		{
+			// A gate that skips results would miss every regression of new workloads and worker counts
+			Out << "MISSING " << Result.Workload << " at " << Result.NumWorkers << " workers: no baseline, write them again with -writebaseline" << std::endl;
+			NumRegressions++;
+			continue;
+		}
+		if (Result.Throughput < Found->Throughput * (1.0 - Options.Tolerance))
+		{
+			Out << "REGRESSION " << Result.Workload << " at " << Result.NumWorkers << " workers: throughput "
+				<< std::setprecision(0) << Result.Throughput << " tasks/s, baseline " << Found->Throughput << std::endl;
+			NumRegressions++;
+		}
+		if (Result.P99Us > Found->P99Us * (1.0 + Options.Tolerance))
+		{
+			Out << "REGRESSION " << Result.Workload << " at " << Result.NumWorkers << " workers: p99 "
+				<< std::setprecision(1) << Result.P99Us << "us, baseline " << Found->P99Us << "us" << std::endl;
+			NumRegressions++;
+		}
+	}
+	Out << NumRegressions << " regression(s) against " << Options.BaselineFile << std::endl;
+	return NumRegressions;
+}
+
+bool FScalabilityHarness::WriteBaselines() const
+{
+	std::ofstream File(Options.BaselineFile);
+	if (!File)
+	{
+		return false;
+	}
+	File << "# workload workers throughput p99us" << std::endl;
+	for (const FScalabilityResult& Result : Results)
+	{
+		File << Result.Workload << ' ' << Result.NumWorkers << ' '
+			<< std::fixed << std::setprecision(0) << Result.Throughput << ' '
+			<< std::setprecision(1) << Result.P99Us << std::endl;
+	}
+	return (bool)File;
+}
+
+int32 FScalabilityHarness::RunFromCommandLine(int32 ArgC, char* ArgV[])
+{
+	FScalabilityOptions Options;
+	for (int32 Index = 1; Index < ArgC; Index++)
+	{
+		const char* Arg = ArgV[Index];
+		if (strncmp(Arg, "-workers=", 9) == 0)
+		{
+			Options.MaxWorkers = atoi(Arg + 9);
+		}
+		else if (strncmp(Arg, "-step=", 6) == 0)
+		{
+			Options.WorkerStep = atoi(Arg + 6);
+		}
+		else if (strncmp(Arg, "-tasks=", 7) == 0)
+		{
+			Options.TasksPerRun = (uint32)atoi(Arg + 7);
+		}
+		else if (strncmp(Arg, "-reps=", 6) == 0)
+		{
+			Options.Repetitions = (uint32)atoi(Arg + 6);
+		}
+		else if (strncmp(Arg, "-tolerance=", 11) == 0)
+		{
+			Options.Tolerance = atof(Arg + 11);
+		}
+		else if (strncmp(Arg, "-baseline=", 10) == 0)
+		{
+			Options.BaselineFile = Arg + 10;
+		}
+		else if (strcmp(Arg, "-writebaseline") == 0)
+		{
+			Options.bWriteBaseline = true;
+		}
+	}
+
+	FScalabilityHarness Harness(Options);
+	return Harness.Run(std::cout) == 0 ? 0 : 1;
+}
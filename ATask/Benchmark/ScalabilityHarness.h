@@ -0,0 +1,158 @@
+#pragma once
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include "../HAL/HAL.h"
+
+class FQueuedThreadPool;
+
+/**
+* Options of a scalability sweep.
+*/
+struct FScalabilityOptions
+{
+	/** The largest worker count of the sweep, 0 for all cores. */
+	int32 MaxWorkers;
+
+	/** The distance between the worker counts of the sweep, 1 runs every count. */
+	int32 WorkerStep;
+
+	/** The number of tasks every workload runs per worker count. */
+	uint32 TasksPerRun;
+
+	/** How many times every run is repeated, the best one is reported. */
+	uint32 Repetitions;
+
+	/** The fraction a result may fall behind its baseline before it counts as a regression. */
+	double Tolerance;
+
+	/** File the baselines are read from or written to, none if empty. */
+	std::string BaselineFile;
+
+	/** Whether to write the results as the new baselines instead of comparing against them. */
+	bool bWriteBaseline;
+
+	FScalabilityOptions()
+		: MaxWorkers(0)
+		, WorkerStep(1)
+		, TasksPerRun(20000)
+		, Repetitions(3)
+		, Tolerance(0.3)
+		, bWriteBaseline(false)
+	{}
+};
+
+/**
+* Result of one workload at one worker count.
+*/
+struct FScalabilityResult
+{
+	std::string Workload;
+	int32 NumWorkers;
+
+	/** Tasks completed per second. */
+	double Throughput;
+
+	/** Task latency percentiles in microseconds. */
+	double P50Us;
+	double P99Us;
+	double P999Us;
+
+	/** Throughput relative to the single worker run divided by the number of workers. */
+	double Efficiency;
+
+	FScalabilityResult()
+		: NumWorkers(0)
+		, Throughput(0.0)
+		, P50Us(0.0)
+		, P99Us(0.0)
+		, P999Us(0.0)
+		, Efficiency(0.0)
+	{}
+};
+
+/**
+* Stress harness measuring how the thread pool and the task graphs scale with the number of cores.
+*
+* Sweeps the worker count from 1 to all cores, restricting the process to as many
+* of its processors as there are workers, and runs synthetic workloads on a pool of that size:
+* uniform tiny tasks, heavy tailed durations, deep dependency chains, wide fan-out and
+* mixed blocking work. The chains and the fan-out also run as a TStaticTaskGraph and
+* as a FIncrementalTaskGraph. Results can be stored as baselines and later runs fail
+* when they regress past the tolerance or have no baselines to compare against. The
+* affinity of the process is restored once the sweep is done.
+*/
+class FScalabilityHarness
+{
+public:
+	explicit FScalabilityHarness(const FScalabilityOptions& InOptions);
+
+	/**
+	* Runs the sweep, prints a report and compares against or writes the baselines.
+	*
+	* @param Out Where the report is written to
+	* @return The number of regressions found, 0 if there were none.
+	*/
+	int32 Run(std::ostream& Out);
+
+	/** @return The results of the last Run. */
+	const std::vector<FScalabilityResult>& GetResults() const
+	{
+		return Results;
+	}
+
+	/**
+	* Runs the sweep configured by command line switches:
+	* -workers=N -step=N -tasks=N -reps=N -tolerance=F -baseline=File -writebaseline
+	*
+	* @return The process exit code, nonzero if a result regressed.
+	*/
+	static int32 RunFromCommandLine(int32 ArgC, char* ArgV[]);
+
+private:
+	/** Measured duration of a run and the latency of each of its tasks in seconds. */
+	struct FRunSample
+	{
+		double Seconds;
+		std::vector<double> Latencies;
+	};
+
+	typedef FRunSample(FScalabilityHarness::*FWorkloadFunction)(FQueuedThreadPool* ThreadPool, int32 NumWorkers);
+
+	struct FWorkload
+	{
+		const char* Name;
+		FWorkloadFunction Function;
+	};
+
+	FRunSample RunUniform(FQueuedThreadPool* ThreadPool, int32 NumWorkers);
+	FRunSample RunHeavyTailed(FQueuedThreadPool* ThreadPool, int32 NumWorkers);
+	FRunSample RunChains(FQueuedThreadPool* ThreadPool, int32 NumWorkers);
+	FRunSample RunFanOut(FQueuedThreadPool* ThreadPool, int32 NumWorkers);
+	FRunSample RunMixedBlocking(FQueuedThreadPool* ThreadPool, int32 NumWorkers);
+	FRunSample RunGraphChains(FQueuedThreadPool* ThreadPool, int32 NumWorkers);
+	FRunSample RunGraphFanOut(FQueuedThreadPool* ThreadPool, int32 NumWorkers);
+	FRunSample RunIncrementalChains(FQueuedThreadPool* ThreadPool, int32 NumWorkers);
+	FRunSample RunIncrementalFanOut(FQueuedThreadPool* ThreadPool, int32 NumWorkers);
+
+	/** Runs independent tasks spinning for the given durations in seconds. */
+	FRunSample RunIndependent(FQueuedThreadPool* ThreadPool, const std::vector<double>& Durations, uint32 BlockingInterval);
+
+	/** @return The worker counts of the sweep. */
+	std::vector<int32> GetWorkerCounts() const;
+
+	/** @return How many times a graph of NumNodes nodes executes to run about TasksPerRun tasks. */
+	uint32 GetNumGraphExecutions(int32 NumNodes) const;
+
+	/**
+	* Compares the results against the baseline file, reporting regressions to Out.
+	* A missing baseline file counts as one regression, a result without a baseline as one each.
+	*/
+	int32 CompareBaselines(std::ostream& Out) const;
+
+	/** Writes the results to the baseline file. */
+	bool WriteBaselines() const;
+
+	FScalabilityOptions Options;
+	std::vector<FScalabilityResult> Results;
+};
@@ -4,5 +4,7 @@
 #include "WindowsCoreType.h"
 #include "WindowsCriticalSection.h"
 #include "WindowsPlatformTls.h"
+#include "WindowsPlatformTime.h"
+#include "WindowsPlatformFile.h"
 #include "WindowsPlatformProcess.h"
 #endif // __Windows__
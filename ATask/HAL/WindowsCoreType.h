@@ -1,7 +1,10 @@
 #pragma once
 #include <windows.h>
 
+typedef unsigned char	uint8;
 typedef unsigned int	uint32;
 typedef int				int32;
 typedef __int64			int64;
-typedef unsigned __int64 uint64;
\ No newline at end of file
+typedef unsigned __int64 uint64;
+
+enum { INDEX_NONE = -1 };
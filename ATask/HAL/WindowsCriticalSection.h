@@ -15,10 +15,15 @@ public:
 
 	__forceinline void Lock()
 	{
-		if (TryEnterCriticalSection(&CriticalSection))
+		if (!TryEnterCriticalSection(&CriticalSection))
 			EnterCriticalSection(&CriticalSection);
 	}
 
+	__forceinline bool TryLock()
+	{
+		return TryEnterCriticalSection(&CriticalSection) != 0;
+	}
+
 	__forceinline void UnLock()
 	{
 		LeaveCriticalSection(&CriticalSection);
@@ -0,0 +1,83 @@
+#include "WindowsPlatformFile.h"
+
+/** Largest amount ReadFile and WriteFile transfer in one call. */
+static const uint64 MaxBytesPerCall = 1u << 30;
+
+static HANDLE OpenFile(const TCHAR* Filename, DWORD Access, DWORD ShareMode, DWORD Disposition, bool bOverlapped)
+{
+	HANDLE Handle = CreateFile(Filename, Access, ShareMode, nullptr, Disposition, FILE_ATTRIBUTE_NORMAL | (bOverlapped ? FILE_FLAG_OVERLAPPED : 0), nullptr);
+	return Handle == INVALID_HANDLE_VALUE ? nullptr : Handle;
+}
+
+HANDLE FWindowsPlatformFile::OpenRead(const TCHAR* Filename, bool bOverlapped /*= false*/)
+{
+	return OpenFile(Filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, OPEN_EXISTING, bOverlapped);
+}
+
+HANDLE FWindowsPlatformFile::OpenWrite(const TCHAR* Filename, bool bTruncate, bool bOverlapped /*= false*/)
+{
+	return OpenFile(Filename, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, bTruncate ? CREATE_ALWAYS : OPEN_ALWAYS, bOverlapped);
+}
+
+int64 FWindowsPlatformFile::Size(HANDLE Handle)
+{
+	LARGE_INTEGER FileSize;
+	if (!GetFileSizeEx(Handle, &FileSize))
+	{
+		return -1;
+	}
+	return FileSize.QuadPart;
+}
+
+bool FWindowsPlatformFile::Read(HANDLE Handle, void* Dest, uint64 Offset, uint64 BytesToRead, uint64& OutBytesRead)
+{
+	OutBytesRead = 0;
+	while (OutBytesRead < BytesToRead)
+	{
+		// The offset goes with every call, the file pointer of the handle is not shared state
+		const uint64 ReadOffset = Offset + OutBytesRead;
+		OVERLAPPED Overlapped = {};
+		Overlapped.Offset = (DWORD)(ReadOffset & 0xFFFFFFFF);
+		Overlapped.OffsetHigh = (DWORD)(ReadOffset >> 32);
+		const uint64 RemainingBytes = BytesToRead - OutBytesRead;
+		DWORD BytesRead = 0;
+		if (!ReadFile(Handle, (uint8*)Dest + OutBytesRead, (DWORD)(RemainingBytes < MaxBytesPerCall ? RemainingBytes : MaxBytesPerCall), &BytesRead, &Overlapped))
+		{
+			return GetLastError() == ERROR_HANDLE_EOF;
+		}
+		if (BytesRead == 0)
+		{
+			break;
+		}
+		OutBytesRead += BytesRead;
+	}
+	return true;
+}
+
+bool FWindowsPlatformFile::Write(HANDLE Handle, const void* Src, uint64 Offset, uint64 BytesToWrite)
+{
+	uint64 BytesWritten = 0;
+	while (BytesWritten < BytesToWrite)
+	{
+		const uint64 WriteOffset = Offset + BytesWritten;
+		OVERLAPPED Overlapped = {};
+		Overlapped.Offset = (DWORD)(WriteOffset & 0xFFFFFFFF);
+		Overlapped.OffsetHigh = (DWORD)(WriteOffset >> 32);
+		const uint64 RemainingBytes = BytesToWrite - BytesWritten;
+		DWORD Written = 0;
+		if (!WriteFile(Handle, (const uint8*)Src + BytesWritten, (DWORD)(RemainingBytes < MaxBytesPerCall ? RemainingBytes : MaxBytesPerCall), &Written, &Overlapped) || Written == 0)
+		{
+			return false;
+		}
+		BytesWritten += Written;
+	}
+	return true;
+}
+
+void FWindowsPlatformFile::Close(HANDLE Handle)
+{
+	if (Handle != nullptr)
+	{
+		CloseHandle(Handle);
+	}
+}
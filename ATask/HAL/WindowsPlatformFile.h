@@ -0,0 +1,63 @@
+#pragma once
+#include <windows.h>
+#include "WindowsCoreType.h"
+
+/**
+* Windows implementation of the File OS functions.
+*
+* Reads and writes are positional, so several threads may use the same handle.
+* Files are opened shared for reading and writing, so requests with their own
+* handles may read and write different ranges of the same file at once.
+*/
+struct FWindowsPlatformFile
+{
+	/**
+	* Opens a file for reading.
+	*
+	* @param Filename The file to open
+	* @param bOverlapped Whether the handle is for overlapped I/O, Read cannot be used with it then
+	* @return The file handle, nullptr if the file could not be opened.
+	*/
+	static HANDLE OpenRead(const TCHAR* Filename, bool bOverlapped = false);
+
+	/**
+	* Opens a file for writing, creating it if it does not exist.
+	*
+	* @param Filename The file to open
+	* @param bTruncate Whether to discard the previous content of the file
+	* @param bOverlapped Whether the handle is for overlapped I/O, Write cannot be used with it then
+	* @return The file handle, nullptr if the file could not be opened.
+	*/
+	static HANDLE OpenWrite(const TCHAR* Filename, bool bTruncate, bool bOverlapped = false);
+
+	/** @return The size of the file in bytes, -1 if it could not be determined. */
+	static int64 Size(HANDLE Handle);
+
+	/**
+	* Reads from a file at an offset.
+	*
+	* @param Handle The file handle
+	* @param Dest Where to read to
+	* @param Offset The offset in the file to read from
+	* @param BytesToRead How many bytes to read
+	* @param OutBytesRead How many bytes were read, less than requested at the end of the file
+	* @return false if reading failed.
+	*/
+	static bool Read(HANDLE Handle, void* Dest, uint64 Offset, uint64 BytesToRead, uint64& OutBytesRead);
+
+	/**
+	* Writes to a file at an offset.
+	*
+	* @param Handle The file handle
+	* @param Src The data to write
+	* @param Offset The offset in the file to write to
+	* @param BytesToWrite How many bytes to write
+	* @return false if not all bytes were written.
+	*/
+	static bool Write(HANDLE Handle, const void* Src, uint64 Offset, uint64 BytesToWrite);
+
+	/** Closes a file handle. */
+	static void Close(HANDLE Handle);
+};
+
+typedef FWindowsPlatformFile FPlatformFile;
@@ -1,9 +1,88 @@
 #include "WindowsPlatformProcess.h"
 #include "WindowsEvent.h"
+#include "WindowsRunableThread.h"
+#include "WindowsCoreType.h"
 #include <assert.h>
+static bool GSupportsMultithreading = true;
+
 bool FWindowsPlatformProcess::SupportsMultithreading()
 {
-	return true; // determined by cmd input parameters.
+	return GSupportsMultithreading; // determined by cmd input parameters.
+}
+
+void FWindowsPlatformProcess::SetSupportsMultithreading(bool bInSupportsMultithreading)
+{
+	GSupportsMultithreading = bInSupportsMultithreading;
+}
+
+FEvent* FWindowsPlatformProcess::CreateSynchEvent(bool bIsManualReset /*= false*/)
+{
+	FEvent* Event = new FEventWin();
+	if (!Event->Create(bIsManualReset))
+	{
+		delete Event;
+		Event = nullptr;
+	}
+	return Event;
+}
+
+FRunnableThread* FWindowsPlatformProcess::CreateRunnableThread()
+{
+	return new FWinRunnableThread();
+}
+
+void FWindowsPlatformProcess::SetThreadAffinityMask(uint64 AffinityMask)
+{
+	DWORD_PTR ProcessAffinityMask = 0;
+	DWORD_PTR SystemAffinityMask = 0;
+	if (::GetProcessAffinityMask(::GetCurrentProcess(), &ProcessAffinityMask, &SystemAffinityMask))
+	{
+		DWORD_PTR ThreadAffinityMask = ProcessAffinityMask & (DWORD_PTR)AffinityMask;
+		::SetThreadAffinityMask(::GetCurrentThread(), ThreadAffinityMask ? ThreadAffinityMask : ProcessAffinityMask);
+	}
+}
+
+bool FWindowsPlatformProcess::SetProcessAffinityMask(uint64 AffinityMask)
+{
+	DWORD_PTR ProcessAffinityMask = 0;
+	DWORD_PTR SystemAffinityMask = 0;
+	if (!::GetProcessAffinityMask(::GetCurrentProcess(), &ProcessAffinityMask, &SystemAffinityMask))
+	{
+		return false;
+	}
+	DWORD_PTR NewAffinityMask = SystemAffinityMask & (DWORD_PTR)AffinityMask;
+	return ::SetProcessAffinityMask(::GetCurrentProcess(), NewAffinityMask ? NewAffinityMask : SystemAffinityMask) != 0;
+}
+
+uint64 FWindowsPlatformProcess::GetProcessAffinityMask()
+{
+	DWORD_PTR ProcessAffinityMask = 0;
+	DWORD_PTR SystemAffinityMask = 0;
+	if (!::GetProcessAffinityMask(::GetCurrentProcess(), &ProcessAffinityMask, &SystemAffinityMask))
+	{
+		return 0;
+	}
+	return (uint64)ProcessAffinityMask;
+}
+
+int32 FWindowsPlatformProcess::NumberOfCores()
+{
+	SYSTEM_INFO SystemInfo;
+	GetSystemInfo(&SystemInfo);
+	return (int32)SystemInfo.dwNumberOfProcessors;
+}
+
+void FWindowsPlatformProcess::Sleep(float Seconds)
+{
+	uint32 Milliseconds = (uint32)(Seconds * 1000.0f);
+	if (Milliseconds == 0)
+	{
+		::SwitchToThread();
+	}
+	else
+	{
+		::Sleep(Milliseconds);
+	}
 }
 
 
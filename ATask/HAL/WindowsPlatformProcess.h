@@ -1,8 +1,60 @@
 #pragma once
+#include "WindowsCoreType.h"
 
 struct FWindowsPlatformProcess
 {
+	/**
+	* Whether threads are created as real OS threads. When false, threads are faked and their
+	* runnables are ticked cooperatively by FThreadManager::Tick on the calling thread.
+	*/
 	static bool SupportsMultithreading();
+
+	/**
+	* Switches between real and fake threads, set from the -nothreading command line switch.
+	* Only affects threads created afterwards, so it is meant to be called once at startup.
+	*
+	* @param bInSupportsMultithreading Whether to create real threads
+	*/
+	static void SetSupportsMultithreading(bool bInSupportsMultithreading);
+
+	/**
+	* Creates a new event.
+	*
+	* @param bIsManualReset Whether the event requires manual reseting or not.
+	* @return A new event, or nullptr none could be created.
+	*/
+	static class FEvent* CreateSynchEvent(bool bIsManualReset = false);
+
+	/**
+	* Creates the platform implementation of a runnable thread, FRunnableThread::Create starts it.
+	*
+	* @return A new, not yet started, runnable thread.
+	*/
+	static class FRunnableThread* CreateRunnableThread();
+
+	/**
+	* Sets the affinity of the calling thread, restricted to the processors the process may use.
+	*
+	* @param AffinityMask The processors the thread may run on, 0 for all of them.
+	*/
+	static void SetThreadAffinityMask(uint64 AffinityMask);
+
+	/**
+	* Restricts the processors all threads of the process may run on.
+	*
+	* @param AffinityMask The processors the process may use, 0 for all processors of the system.
+	* @return true if the affinity was changed.
+	*/
+	static bool SetProcessAffinityMask(uint64 AffinityMask);
+
+	/** @return The processors the process may run on, 0 if they could not be queried. */
+	static uint64 GetProcessAffinityMask();
+
+	/** @return The number of logical processors the system has. */
+	static int32 NumberOfCores();
+
+	/** Sleep this thread for Seconds. 0.0 means release the current time slice to let other threads get some attention. */
+	static void Sleep(float Seconds);
 };
 
-typedef FWindowsPlatformProcess FPlatformProcess;
\ No newline at end of file
+typedef FWindowsPlatformProcess FPlatformProcess;
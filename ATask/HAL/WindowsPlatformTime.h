@@ -0,0 +1,41 @@
+#pragma once
+#include <windows.h>
+#include "WindowsCoreType.h"
+
+/**
+* Windows implementation of the Time OS functions.
+*/
+struct FWindowsPlatformTime
+{
+	/**
+	* Returns the current value of the high resolution counter.
+	*
+	* @return The counter value, convert with GetSecondsPerCycle64.
+	*/
+	static __forceinline uint64 Cycles64()
+	{
+		LARGE_INTEGER Cycles;
+		QueryPerformanceCounter(&Cycles);
+		return Cycles.QuadPart;
+	}
+
+	/** @return The duration of one Cycles64 tick in seconds. */
+	static __forceinline double GetSecondsPerCycle64()
+	{
+		static const double SecondsPerCycle = []()
+		{
+			LARGE_INTEGER Frequency;
+			QueryPerformanceFrequency(&Frequency);
+			return 1.0 / (double)Frequency.QuadPart;
+		}();
+		return SecondsPerCycle;
+	}
+
+	/** @return The current time in seconds, only meaningful relative to another call. */
+	static __forceinline double Seconds()
+	{
+		return (double)Cycles64() * GetSecondsPerCycle64();
+	}
+};
+
+typedef FWindowsPlatformTime FPlatformTime;
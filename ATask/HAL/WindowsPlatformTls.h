@@ -12,7 +12,7 @@ struct FWindowsPlatformTLS
 	*/
 	static __forceinline uint32 GetCurrentThreadId(void)
 	{
-		return GetCurrentThreadId();
+		return ::GetCurrentThreadId();
 	}
 
 	/**
@@ -0,0 +1,162 @@
+#include <cassert>
+#include "WindowsRunableThread.h"
+#include "Event.h"
+#include "../Thread/Runnable.h"
+#include "../Thread/ThreadManager.h"
+
+int FWinRunnableThread::TranslateThreadPriority(EThreadPriority Priority)
+{
+	switch (Priority)
+	{
+	case TPri_AboveNormal: return THREAD_PRIORITY_ABOVE_NORMAL;
+	case TPri_Normal: return THREAD_PRIORITY_NORMAL;
+	case TPri_BelowNormal: return THREAD_PRIORITY_BELOW_NORMAL;
+	case TPri_Highest: return THREAD_PRIORITY_HIGHEST;
+	case TPri_TimeCritical: return THREAD_PRIORITY_HIGHEST;
+	case TPri_Lowest: return THREAD_PRIORITY_LOWEST;
+	case TPri_SlightlyBelowNormal: return THREAD_PRIORITY_NORMAL - 1;
+	default: assert(!"Unknown Priority passed to TranslateThreadPriority()"); return THREAD_PRIORITY_NORMAL;
+	}
+}
+
+void FWinRunnableThread::SetThreadPriority(EThreadPriority NewPriority)
+{
+	// Don't bother calling the OS if there is no need
+	if (NewPriority != ThreadPriority)
+	{
+		ThreadPriority = NewPriority;
+		// Change the priority on the thread
+		::SetThreadPriority(Thread, TranslateThreadPriority(ThreadPriority));
+	}
+}
+
+void FWinRunnableThread::Suspend(bool bShouldPause /*= true*/)
+{
+	assert(Thread);
+	if (bShouldPause)
+	{
+		SuspendThread(Thread);
+	}
+	else
+	{
+		ResumeThread(Thread);
+	}
+}
+
+bool FWinRunnableThread::Kill(bool bShouldWait /*= true*/)
+{
+	assert(Thread && "Did you forget to call Create()?");
+	bool bDidExitOK = true;
+	// Let the runnable have a chance to stop without brute killing
+	if (Runnable)
+	{
+		Runnable->Stop();
+	}
+	// If waiting was specified, wait the amount of time. If that fails,
+	// brute force kill that thread. Very bad as that might leak.
+	if (bShouldWait)
+	{
+		WaitForSingleObject(Thread, INFINITE);
+	}
+	// Now clean up the thread handle so we don't leak
+	CloseHandle(Thread);
+	Thread = nullptr;
+	return bDidExitOK;
+}
+
+void FWinRunnableThread::WaitForCompletion()
+{
+	// Block until this thread exits
+	WaitForSingleObject(Thread, INFINITE);
+}
+
+bool FWinRunnableThread::CreateInternal(FRunnable* InRunnable, const TCHAR* InThreadName,
+	uint32 InStackSize /*= 0*/,
+	EThreadPriority InThreadPri /*= TPri_Normal*/, uint64 InThreadAffinityMask /*= 0*/)
+{
+	assert(InRunnable);
+	Runnable = InRunnable;
+	ThreadAffinityMask = InThreadAffinityMask;
+	SetThreadName(InThreadName);
+
+	// Create a sync event to guarantee the Init() function is called first
+	FEvent* InitSyncEvent = FPlatformProcess::CreateSynchEvent(true);
+	ThreadInitSyncEvent = InitSyncEvent;
+
+	// Create the new thread suspended, so that everything the thread reads is set before it starts
+	Thread = CreateThread(nullptr, InStackSize, _ThreadProc, this, STACK_SIZE_PARAM_IS_A_RESERVATION | CREATE_SUSPENDED, (DWORD*)&ThreadID);
+	const bool bCreated = (Thread != nullptr);
+	if (bCreated)
+	{
+		ThreadPriority = TPri_Normal;
+		SetThreadPriority(InThreadPri);
+		ResumeThread(Thread);
+
+		// Let the thread start up. An auto deleting thread may be gone once this returns, so nothing touches this afterwards
+		InitSyncEvent->Wait(INFINITE);
+	}
+	else
+	{
+		Runnable = nullptr;
+		ThreadInitSyncEvent = nullptr;
+	}
+	delete InitSyncEvent;
+	return bCreated;
+}
+
+DWORD WINAPI FWinRunnableThread::_ThreadProc(LPVOID pThis)
+{
+	assert(pThis);
+	FWinRunnableThread* RunnableThread = (FWinRunnableThread*)pThis;
+	const uint32 ExitCode = RunnableThread->Run();
+
+	if (RunnableThread->bAutoDeleteRunnable)
+	{
+		delete RunnableThread->Runnable;
+		RunnableThread->Runnable = nullptr;
+	}
+	if (RunnableThread->bAutoDeleteSelf)
+	{
+		CloseHandle(RunnableThread->Thread);
+		RunnableThread->Thread = nullptr;
+		delete RunnableThread;
+	}
+	return ExitCode;
+}
+
+uint32 FWinRunnableThread::Run()
+{
+	FPlatformProcess::SetThreadAffinityMask(ThreadAffinityMask);
+	FThreadManager::Get().AddThread(ThreadID, this);
+
+	// Assume we'll fail init
+	uint32 ExitCode = 1;
+	assert(Runnable);
+
+	// Initialize the runnable object
+	if (Runnable->Init() == true)
+	{
+		// Initialization has completed, release the sync event
+		ThreadInitSyncEvent->Trigger();
+		ThreadInitSyncEvent = nullptr;
+
+		// Setup TLS for this thread, used by FTlsAutoCleanup objects.
+		SetTls();
+
+		// Now run the task that needs to be done
+		ExitCode = Runnable->Run();
+		// Allow any allocated resources to be cleaned up
+		Runnable->Exit();
+
+		FreeTls();
+	}
+	else
+	{
+		// Initialization has failed, release the sync event
+		ThreadInitSyncEvent->Trigger();
+		ThreadInitSyncEvent = nullptr;
+	}
+
+	FThreadManager::Get().RemoveThread(this);
+	return ExitCode;
+}
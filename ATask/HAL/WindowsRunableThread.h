@@ -1,6 +1,61 @@
 #pragma once
 #include "../Thread/RunnableThread.h"
+
+/**
+* This is the base interface for all runnable thread classes. It specifies the
+* methods used in managing its life cycle.
+*/
 class FWinRunnableThread : public FRunnableThread
 {
+public:
+	/** Default constructor. */
+	FWinRunnableThread()
+		: Thread(nullptr)
+	{}
+
+	/** Cleans up any resources. */
+	virtual ~FWinRunnableThread()
+	{
+		// Clean up our thread if it is still active
+		if (Thread != nullptr)
+		{
+			Kill(true);
+		}
+	}
+
+	/**
+	* Converts an EThreadPriority to a value that can be used in SetThreadPriority.
+	*
+	* @param Priority The priority to convert
+	* @return The converted value.
+	*/
+	static int TranslateThreadPriority(EThreadPriority Priority);
+
+	// FRunnableThread interface
+
+	virtual void SetThreadPriority(EThreadPriority NewPriority) override;
+	virtual void Suspend(bool bShouldPause = true) override;
+	virtual bool Kill(bool bShouldWait = true) override;
+	virtual void WaitForCompletion() override;
+
+protected:
+	virtual bool CreateInternal(FRunnable* InRunnable, const TCHAR* InThreadName,
+		uint32 InStackSize = 0,
+		EThreadPriority InThreadPri = TPri_Normal, uint64 InThreadAffinityMask = 0) override;
+
+private:
+	/**
+	* The thread entry point. Simply forwards the call on to the right thread main function.
+	*/
+	static DWORD WINAPI _ThreadProc(LPVOID pThis);
+
+	/**
+	* The real thread entry point. It calls the Init/Run/Exit methods on the runnable object.
+	*
+	* @return The exit code of the thread.
+	*/
+	uint32 Run();
 
-};
\ No newline at end of file
+	/** The thread handle for the thread. */
+	HANDLE Thread;
+};
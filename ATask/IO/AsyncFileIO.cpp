@@ -0,0 +1,679 @@
+#include <atomic>
+#include <cassert>
+#include <deque>
+#include "AsyncFileIO.h"
+#include "../HAL/Event.h"
+#include "../Thread/LockProfiler.h"
+#include "../Thread/Runnable.h"
+#include "../Thread/RunnableThread.h"
+#include "../Thread/SingleThreadRunnable.h"
+#include "../Thread/TaskGroup.h"
+
+/** Sets the result of a request, then lets its group go on. */
+static void CompleteRequest(TPromise<FAsyncIOResult>& Promise, FTaskGroup* CompletionGroup, FAsyncIOResult&& Result)
+{
+	Promise.SetValue(std::move(Result));
+	if (CompletionGroup != nullptr)
+	{
+		CompletionGroup->Done();
+	}
+}
+
+/////////////////////////////////////Requests/////////////////////////////////////
+FAsyncIORequest FAsyncIORequest::Read(const TCHAR* InFilename, uint64 InOffset /*= 0*/, uint64 InSize /*= 0*/, void* InBuffer /*= nullptr*/)
+{
+	assert(InBuffer == nullptr || InSize > 0);
+	FAsyncIORequest Request;
+	Request.Operation = EAsyncIOOperation::Read;
+	Request.Filename = InFilename;
+	Request.Offset = InOffset;
+	Request.Size = InSize;
+	Request.Buffer = InBuffer;
+	return Request;
+}
+
+FAsyncIORequest FAsyncIORequest::Write(const TCHAR* InFilename, const void* InData, uint64 InSize, uint64 InOffset /*= 0*/, bool bInTruncate /*= false*/)
+{
+	assert(InData || InSize == 0);
+	FAsyncIORequest Request;
+	Request.Operation = EAsyncIOOperation::Write;
+	Request.Filename = InFilename;
+	Request.Offset = InOffset;
+	Request.Size = InSize;
+	Request.Buffer = const_cast<void*>(InData);
+	Request.bTruncate = bInTruncate;
+	return Request;
+}
+
+TFuture<FAsyncIOResult> IAsyncFileIO::Submit(FAsyncIORequest Request)
+{
+	std::vector<FAsyncIORequest> Requests;
+	Requests.push_back(std::move(Request));
+	return std::move(SubmitBatch(std::move(Requests))[0]);
+}
+
+/////////////////////////////////////Threaded Async File IO/////////////////////////////////////
+/**
+* Portable implementation, dedicated threads execute the requests with blocking calls.
+*/
+class FThreadedAsyncFileIO : public IAsyncFileIO
+{
+public:
+	FThreadedAsyncFileIO(int32 NumIOThreads, FQueuedThreadPool* InCompletionPool);
+	virtual ~FThreadedAsyncFileIO();
+
+	virtual std::vector<TFuture<FAsyncIOResult>> SubmitBatch(std::vector<FAsyncIORequest> Requests) override;
+
+	virtual int32 GetNumPending() const override
+	{
+		return NumPending.load(std::memory_order_relaxed);
+	}
+
+private:
+	struct FPendingRequest
+	{
+		FAsyncIORequest				Request;
+		TPromise<FAsyncIOResult>	Promise;
+
+		FPendingRequest(FAsyncIORequest&& InRequest, FQueuedThreadPool* InCompletionPool)
+			: Request(std::move(InRequest))
+			, Promise(InCompletionPool)
+		{}
+	};
+
+	/**
+	* Runnable of one I/O thread.
+	*/
+	class FIOThread : public FRunnable, public FSingleThreadRunnable
+	{
+	public:
+		explicit FIOThread(FThreadedAsyncFileIO* InOwner)
+			: Owner(InOwner)
+			, Thread(nullptr)
+		{}
+
+		virtual int Run() override
+		{
+			Owner->ProcessRequests();
+			return 0;
+		}
+
+		virtual void Stop() override
+		{
+			Owner->TimeToDie.store(true);
+			Owner->WorkEvent->Trigger();
+		}
+
+		virtual FSingleThreadRunnable* GetSingleThreadInterface() override
+		{
+			return this;
+		}
+
+		/** Executes one request per tick when faked. */
+		virtual bool Tick() override
+		{
+			return Owner->ProcessOneRequest();
+		}
+
+		FThreadedAsyncFileIO*	Owner;
+		FRunnableThread*		Thread;
+	};
+
+	/** Executes requests until it is time to die. */
+	void ProcessRequests();
+
+	/** @return false if there was no request to execute. */
+	bool ProcessOneRequest();
+
+	/** @return The oldest request, nullptr if there is none. */
+	FPendingRequest* PopRequest();
+
+	static FAsyncIOResult ExecuteRequest(FAsyncIORequest& Request);
+
+	FQueuedThreadPool*				CompletionPool;
+	std::vector<FIOThread*>			IOThreads;
+
+	std::deque<FPendingRequest*>	Requests;
+	FCriticalSection				RequestsCritical;
+
+	/** Auto reset, a woken thread wakes the next one while requests are left. */
+	FEvent*							WorkEvent;
+
+	std::atomic<bool>				TimeToDie;
+	std::atomic<int32>				NumPending;
+};
+
+FThreadedAsyncFileIO::FThreadedAsyncFileIO(int32 NumIOThreads, FQueuedThreadPool* InCompletionPool)
+	: CompletionPool(InCompletionPool ? InCompletionPool : GThreadPool)
+	, WorkEvent(FPlatformProcess::CreateSynchEvent())
+	, TimeToDie(false)
+	, NumPending(0)
+{
+	assert(CompletionPool);
+	assert(NumIOThreads > 0);
+	for (int32 Index = 0; Index < NumIOThreads; Index++)
+	{
+		FIOThread* IOThread = new FIOThread(this);
+		IOThread->Thread = FRunnableThread::Create(IOThread, TEXT("AsyncIOThread"), 64u * 1024u);
+		if (IOThread->Thread == nullptr)
+		{
+			delete IOThread;
+			break;
+		}
+		IOThreads.push_back(IOThread);
+	}
+	assert(!IOThreads.empty());
+}
+
+FThreadedAsyncFileIO::~FThreadedAsyncFileIO()
+{
+	for (FIOThread* IOThread : IOThreads)
+	{
+		IOThread->Thread->Kill(true);
+		delete IOThread->Thread;
+		delete IOThread;
+	}
+
+	// Nobody executes what is left, complete it so that no future waits forever
+	while (FPendingRequest* Pending = PopRequest())
+	{
+		CompleteRequest(Pending->Promise, Pending->Request.CompletionGroup, FAsyncIOResult());
+		delete Pending;
+		NumPending.fetch_sub(1, std::memory_order_relaxed);
+	}
+	delete WorkEvent;
+}
+
+std::vector<TFuture<FAsyncIOResult>> FThreadedAsyncFileIO::SubmitBatch(std::vector<FAsyncIORequest> InRequests)
+{
+	std::vector<TFuture<FAsyncIOResult>> Futures;
+	if (InRequests.empty())
+	{
+		return Futures;
+	}
+
+	std::vector<FPendingRequest*> PendingRequests;
+	PendingRequests.reserve(InRequests.size());
+	Futures.reserve(InRequests.size());
+	for (FAsyncIORequest& Request : InRequests)
+	{
+		if (Request.CompletionGroup != nullptr)
+		{
+			Request.CompletionGroup->Add();
+		}
+		PendingRequests.push_back(new FPendingRequest(std::move(Request), CompletionPool));
+		Futures.push_back(PendingRequests.back()->Promise.GetFuture());
+	}
+
+	NumPending.fetch_add((int32)PendingRequests.size(), std::memory_order_relaxed);
+	{
+		SCOPE_LOCK(&RequestsCritical);
+		Requests.insert(Requests.end(), PendingRequests.begin(), PendingRequests.end());
+	}
+	WorkEvent->Trigger();
+	return Futures;
+}
+
+FThreadedAsyncFileIO::FPendingRequest* FThreadedAsyncFileIO::PopRequest()
+{
+	SCOPE_LOCK(&RequestsCritical);
+	if (Requests.empty())
+	{
+		return nullptr;
+	}
+	FPendingRequest* Pending = Requests.front();
+	Requests.pop_front();
+	if (!Requests.empty())
+	{
+		// Hand the rest of a batch to the next thread
+		WorkEvent->Trigger();
+	}
+	return Pending;
+}
+
+void FThreadedAsyncFileIO::ProcessRequests()
+{
+	while (!TimeToDie.load())
+	{
+		if (!ProcessOneRequest())
+		{
+			WorkEvent->Wait();
+		}
+	}
+	// Pass the stop on, the event only wakes one thread at a time
+	WorkEvent->Trigger();
+}
+
+bool FThreadedAsyncFileIO::ProcessOneRequest()
+{
+	FPendingRequest* Pending = PopRequest();
+	if (Pending == nullptr)
+	{
+		return false;
+	}
+
+	// Continuations run on the completion pool, never on this thread
+	CompleteRequest(Pending->Promise, Pending->Request.CompletionGroup, ExecuteRequest(Pending->Request));
+	delete Pending;
+	NumPending.fetch_sub(1, std::memory_order_relaxed);
+	return true;
+}
+
+FAsyncIOResult FThreadedAsyncFileIO::ExecuteRequest(FAsyncIORequest& Request)
+{
+	FAsyncIOResult Result;
+	if (Request.Operation == EAsyncIOOperation::Read)
+	{
+		HANDLE Handle = FPlatformFile::OpenRead(Request.Filename.c_str());
+		if (Handle == nullptr)
+		{
+			return Result;
+		}
+		uint64 Size = Request.Size;
+		if (Size == 0)
+		{
+			const int64 FileSize = FPlatformFile::Size(Handle);
+			Size = FileSize > (int64)Request.Offset ? (uint64)FileSize - Request.Offset : 0;
+		}
+		void* Dest = Request.Buffer;
+		if (Dest == nullptr)
+		{
+			Result.Data.resize((size_t)Size);
+			Dest = Result.Data.data();
+		}
+		Result.bSucceeded = FPlatformFile::Read(Handle, Dest, Request.Offset, Size, Result.BytesTransferred);
+		if (Request.Buffer == nullptr)
+		{
+			Result.Data.resize((size_t)Result.BytesTransferred);
+		}
+		FPlatformFile::Close(Handle);
+	}
+	else
+	{
+		HANDLE Handle = FPlatformFile::OpenWrite(Request.Filename.c_str(), Request.bTruncate);
+		if (Handle == nullptr)
+		{
+			return Result;
+		}
+		Result.bSucceeded = FPlatformFile::Write(Handle, Request.Buffer, Request.Offset, Request.Size);
+		Result.BytesTransferred = Result.bSucceeded ? Request.Size : 0;
+		FPlatformFile::Close(Handle);
+	}
+	return Result;
+}
+
+IAsyncFileIO* IAsyncFileIO::CreateThreaded(int32 NumIOThreads /*= 2*/, FQueuedThreadPool* CompletionPool /*= nullptr*/)
+{
+	return new FThreadedAsyncFileIO(NumIOThreads, CompletionPool);
+}
+
+/////////////////////////////////////Overlapped Async File IO/////////////////////////////////////
+/**
+* Native implementation, requests are issued as overlapped reads and writes on handles
+* associated with an I/O completion port, one thread collects the completions.
+*
+* Opening a file is the one call that cannot be overlapped, so submitting only posts the
+* batch to the port as a single packet and the completion thread opens the files and
+* issues the first parts. The submitting thread makes no blocking system call and a
+* batch costs one wake up; the opens of a batch run one after the other on the
+* completion thread, delaying the completions handled meanwhile.
+*/
+class FOverlappedAsyncFileIO : public IAsyncFileIO
+{
+public:
+	FOverlappedAsyncFileIO(HANDLE InCompletionPort, FQueuedThreadPool* InCompletionPool);
+	virtual ~FOverlappedAsyncFileIO();
+
+	/** @return false if the completion thread could not be created. */
+	bool StartCompletionThread();
+
+	virtual std::vector<TFuture<FAsyncIOResult>> SubmitBatch(std::vector<FAsyncIORequest> Requests) override;
+
+	virtual int32 GetNumPending() const override
+	{
+		return NumPending.load(std::memory_order_relaxed);
+	}
+
+private:
+	/** Largest amount one overlapped call transfers, longer requests are issued in parts. */
+	static const uint64 MaxBytesPerCall = 1u << 30;
+
+	/** Completion key of the packets carrying a submitted batch, 0 stops the thread and handles use their request. */
+	static const ULONG_PTR SubmitKey = 1;
+
+	struct FPendingRequest
+	{
+		FAsyncIORequest				Request;
+		TPromise<FAsyncIOResult>	Promise;
+		FAsyncIOResult				Result;
+		HANDLE						Handle;
+
+		/** Where the bytes are read from or written to and how many in total. */
+		uint8*						Data;
+		uint64						Size;
+
+		/** Of the part in flight, the kernel owns it until its completion was dequeued. */
+		OVERLAPPED					Overlapped;
+
+		FPendingRequest(FAsyncIORequest&& InRequest, FQueuedThreadPool* InCompletionPool)
+			: Request(std::move(InRequest))
+			, Promise(InCompletionPool)
+			, Handle(nullptr)
+			, Data(nullptr)
+			, Size(0)
+			, Overlapped()
+		{}
+	};
+
+	/**
+	* Runnable of the completion thread.
+	*/
+	class FCompletionThread : public FRunnable, public FSingleThreadRunnable
+	{
+	public:
+		explicit FCompletionThread(FOverlappedAsyncFileIO* InOwner)
+			: Owner(InOwner)
+		{}
+
+		virtual int Run() override
+		{
+			// Requests in flight are finished before it stops, the kernel still writes to them
+			while (!Owner->bStopping || Owner->NumPending.load() != 0)
+			{
+				Owner->ProcessCompletion(INFINITE);
+			}
+			return 0;
+		}
+
+		virtual void Stop() override
+		{
+			// Completion key 0 is not a request
+			PostQueuedCompletionStatus(Owner->CompletionPort, 0, 0, nullptr);
+		}
+
+		virtual FSingleThreadRunnable* GetSingleThreadInterface() override
+		{
+			return this;
+		}
+
+		/** Handles one completion per tick when faked. */
+		virtual bool Tick() override
+		{
+			return Owner->ProcessCompletion(0);
+		}
+
+	private:
+		FOverlappedAsyncFileIO* Owner;
+	};
+
+	/** Requests submitted together, handed to the completion thread in one packet. */
+	struct FSubmittedBatch
+	{
+		std::vector<FPendingRequest*> Requests;
+	};
+
+	/** Opens the file of a request and issues its first part, completes it if that fails. */
+	void StartRequest(FPendingRequest* Pending);
+
+	/** Issues the next part of a request, completes it if that fails. */
+	void IssueNextPart(FPendingRequest* Pending);
+
+	/**
+	* Waits for one completion and handles it.
+	*
+	* @param WaitMs How long to wait, INFINITE to wait until there is one
+	* @return true if a part of a request completed or a submitted batch was started.
+	*/
+	bool ProcessCompletion(DWORD WaitMs);
+
+	void FinishRequest(FPendingRequest* Pending, bool bSucceeded);
+
+	HANDLE						CompletionPort;
+	FQueuedThreadPool*			CompletionPool;
+	FCompletionThread*			CompletionRunnable;
+	FRunnableThread*			CompletionThread;
+
+	/** Whether the completion thread is faked, the deleting thread has to finish the requests then. */
+	bool						bTickedCompletions;
+
+	/** Set by the completion thread once it was told to stop. */
+	bool						bStopping;
+
+	std::atomic<int32>			NumPending;
+};
+
+FOverlappedAsyncFileIO::FOverlappedAsyncFileIO(HANDLE InCompletionPort, FQueuedThreadPool* InCompletionPool)
+	: CompletionPort(InCompletionPort)
+	, CompletionPool(InCompletionPool ? InCompletionPool : GThreadPool)
+	, CompletionRunnable(nullptr)
+	, CompletionThread(nullptr)
+	, bTickedCompletions(!FPlatformProcess::SupportsMultithreading())
+	, bStopping(false)
+	, NumPending(0)
+{
+	assert(CompletionPool);
+}
+
+bool FOverlappedAsyncFileIO::StartCompletionThread()
+{
+	CompletionRunnable = new FCompletionThread(this);
+	CompletionThread = FRunnableThread::Create(CompletionRunnable, TEXT("AsyncIOCompletionThread"), 64u * 1024u);
+	return CompletionThread != nullptr;
+}
+
+FOverlappedAsyncFileIO::~FOverlappedAsyncFileIO()
+{
+	if (CompletionThread != nullptr)
+	{
+		if (bTickedCompletions)
+		{
+			while (NumPending.load() != 0)
+			{
+				ProcessCompletion(INFINITE);
+			}
+		}
+		CompletionThread->Kill(true);
+		delete CompletionThread;
+	}
+	delete CompletionRunnable;
+	CloseHandle(CompletionPort);
+}
+
+std::vector<TFuture<FAsyncIOResult>> FOverlappedAsyncFileIO::SubmitBatch(std::vector<FAsyncIORequest> InRequests)
+{
+	std::vector<TFuture<FAsyncIOResult>> Futures;
+	if (InRequests.empty())
+	{
+		return Futures;
+	}
+	Futures.reserve(InRequests.size());
+	FSubmittedBatch* Batch = new FSubmittedBatch();
+	Batch->Requests.reserve(InRequests.size());
+	for (FAsyncIORequest& Request : InRequests)
+	{
+		if (Request.CompletionGroup != nullptr)
+		{
+			Request.CompletionGroup->Add();
+		}
+		FPendingRequest* Pending = new FPendingRequest(std::move(Request), CompletionPool);
+		Futures.push_back(Pending->Promise.GetFuture());
+		Batch->Requests.push_back(Pending);
+	}
+	NumPending.fetch_add((int32)Batch->Requests.size(), std::memory_order_relaxed);
+
+	// A posted packet hands its pointer through untouched, the completion thread opens the files
+	if (!PostQueuedCompletionStatus(CompletionPort, 0, SubmitKey, (OVERLAPPED*)Batch))
+	{
+		for (FPendingRequest* Pending : Batch->Requests)
+		{
+			StartRequest(Pending);
+		}
+		delete Batch;
+	}
+	return Futures;
+}
+
+void FOverlappedAsyncFileIO::StartRequest(FPendingRequest* Pending)
+{
+	FAsyncIORequest& Request = Pending->Request;
+	if (Request.Operation == EAsyncIOOperation::Read)
+	{
+		Pending->Handle = FPlatformFile::OpenRead(Request.Filename.c_str(), true);
+		if (Pending->Handle == nullptr)
+		{
+			FinishRequest(Pending, false);
+			return;
+		}
+		Pending->Size = Request.Size;
+		if (Pending->Size == 0)
+		{
+			const int64 FileSize = FPlatformFile::Size(Pending->Handle);
+			Pending->Size = FileSize > (int64)Request.Offset ? (uint64)FileSize - Request.Offset : 0;
+		}
+		if (Request.Buffer == nullptr)
+		{
+			Pending->Result.Data.resize((size_t)Pending->Size);
+			Pending->Data = Pending->Result.Data.data();
+		}
+		else
+		{
+			Pending->Data = (uint8*)Request.Buffer;
+		}
+	}
+	else
+	{
+		Pending->Handle = FPlatformFile::OpenWrite(Request.Filename.c_str(), Request.bTruncate, true);
+		if (Pending->Handle == nullptr)
+		{
+			FinishRequest(Pending, false);
+			return;
+		}
+		Pending->Size = Request.Size;
+		Pending->Data = (uint8*)Request.Buffer;
+	}
+
+	if (Pending->Size == 0)
+	{
+		FinishRequest(Pending, true);
+		return;
+	}
+	// Completions of the handle carry the request as their key
+	if (CreateIoCompletionPort(Pending->Handle, CompletionPort, (ULONG_PTR)Pending, 0) == nullptr)
+	{
+		FinishRequest(Pending, false);
+		return;
+	}
+	IssueNextPart(Pending);
+}
+
+void FOverlappedAsyncFileIO::IssueNextPart(FPendingRequest* Pending)
+{
+	const uint64 Transferred = Pending->Result.BytesTransferred;
+	const uint64 Offset = Pending->Request.Offset + Transferred;
+	const uint64 RemainingBytes = Pending->Size - Transferred;
+	const DWORD Bytes = (DWORD)(RemainingBytes < MaxBytesPerCall ? RemainingBytes : MaxBytesPerCall);
+
+	Pending->Overlapped = OVERLAPPED();
+	Pending->Overlapped.Offset = (DWORD)(Offset & 0xFFFFFFFF);
+	Pending->Overlapped.OffsetHigh = (DWORD)(Offset >> 32);
+	const BOOL bDone = Pending->Request.Operation == EAsyncIOOperation::Read
+		? ReadFile(Pending->Handle, Pending->Data + Transferred, Bytes, nullptr, &Pending->Overlapped)
+		: WriteFile(Pending->Handle, Pending->Data + Transferred, Bytes, nullptr, &Pending->Overlapped);
+	// A part that completes at once still queues its completion on the port
+	if (bDone)
+	{
+		return;
+	}
+	const DWORD Error = GetLastError();
+	if (Error == ERROR_IO_PENDING)
+	{
+		return;
+	}
+	FinishRequest(Pending, Pending->Request.Operation == EAsyncIOOperation::Read && Error == ERROR_HANDLE_EOF);
+}
+
+bool FOverlappedAsyncFileIO::ProcessCompletion(DWORD WaitMs)
+{
+	DWORD Bytes = 0;
+	ULONG_PTR Key = 0;
+	OVERLAPPED* Overlapped = nullptr;
+	const BOOL bSucceeded = GetQueuedCompletionStatus(CompletionPort, &Bytes, &Key, &Overlapped, WaitMs);
+	if (Overlapped == nullptr)
+	{
+		// Timed out, or the stop posted by the completion thread
+		if (bSucceeded && Key == 0)
+		{
+			bStopping = true;
+		}
+		return false;
+	}
+
+	if (Key == SubmitKey)
+	{
+		FSubmittedBatch* Batch = (FSubmittedBatch*)Overlapped;
+		for (FPendingRequest* Pending : Batch->Requests)
+		{
+			StartRequest(Pending);
+		}
+		delete Batch;
+		return true;
+	}
+
+	FPendingRequest* Pending = (FPendingRequest*)Key;
+	if (!bSucceeded)
+	{
+		// Reading past the end completes with an error, what was read before is the result
+		FinishRequest(Pending, Pending->Request.Operation == EAsyncIOOperation::Read && GetLastError() == ERROR_HANDLE_EOF);
+		return true;
+	}
+
+	Pending->Result.BytesTransferred += Bytes;
+	if (Bytes == 0 || Pending->Result.BytesTransferred >= Pending->Size)
+	{
+		FinishRequest(Pending, Pending->Request.Operation == EAsyncIOOperation::Read || Pending->Result.BytesTransferred == Pending->Size);
+		return true;
+	}
+	IssueNextPart(Pending);
+	return true;
+}
+
+void FOverlappedAsyncFileIO::FinishRequest(FPendingRequest* Pending, bool bSucceeded)
+{
+	FPlatformFile::Close(Pending->Handle);
+	if (Pending->Request.Operation == EAsyncIOOperation::Read && Pending->Request.Buffer == nullptr)
+	{
+		Pending->Result.Data.resize((size_t)Pending->Result.BytesTransferred);
+	}
+	Pending->Result.bSucceeded = bSucceeded;
+	if (!bSucceeded && Pending->Request.Operation == EAsyncIOOperation::Write)
+	{
+		Pending->Result.BytesTransferred = 0;
+	}
+
+	// Continuations run on the completion pool, never on the completion thread
+	CompleteRequest(Pending->Promise, Pending->Request.CompletionGroup, std::move(Pending->Result));
+	delete Pending;
+	NumPending.fetch_sub(1, std::memory_order_relaxed);
+}
+
+IAsyncFileIO* IAsyncFileIO::CreateOverlapped(FQueuedThreadPool* CompletionPool /*= nullptr*/)
+{
+	HANDLE CompletionPort = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+	if (CompletionPort == nullptr)
+	{
+		return nullptr;
+	}
+	FOverlappedAsyncFileIO* FileIO = new FOverlappedAsyncFileIO(CompletionPort, CompletionPool);
+	if (!FileIO->StartCompletionThread())
+	{
+		delete FileIO;
+		return nullptr;
+	}
+	return FileIO;
+}
+
+IAsyncFileIO* IAsyncFileIO::Create(FQueuedThreadPool* CompletionPool /*= nullptr*/)
+{
+	IAsyncFileIO* FileIO = CreateOverlapped(CompletionPool);
+	return FileIO != nullptr ? FileIO : CreateThreaded(2, CompletionPool);
+}
@@ -0,0 +1,143 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "../HAL/HAL.h"
+#include "../Thread/Future.h"
+
+class FQueuedThreadPool;
+class FTaskGroup;
+
+enum class EAsyncIOOperation : uint8
+{
+	Read,
+	Write,
+};
+
+/**
+* One read or write of a file.
+*/
+struct FAsyncIORequest
+{
+	EAsyncIOOperation			Operation;
+	std::basic_string<TCHAR>	Filename;
+
+	/** The offset in the file to start at. */
+	uint64						Offset;
+
+	/** How many bytes to transfer, 0 reads to the end of the file. */
+	uint64						Size;
+
+	/**
+	* Read: where to read to, nullptr to read into FAsyncIOResult::Data.
+	* Write: the data to write. Must stay valid until the request completed.
+	*/
+	void*						Buffer;
+
+	/** Write: whether to discard the previous content of the file. */
+	bool						bTruncate;
+
+	/**
+	* Group waiting for the request, nullptr for none. The request is added to it when it is
+	* submitted and done once its result was set, so a task or graph node waiting on the group
+	* resumes when the data is there.
+	*/
+	FTaskGroup*					CompletionGroup;
+
+	FAsyncIORequest()
+		: Operation(EAsyncIOOperation::Read)
+		, Offset(0)
+		, Size(0)
+		, Buffer(nullptr)
+		, bTruncate(false)
+		, CompletionGroup(nullptr)
+	{}
+
+	static FAsyncIORequest Read(const TCHAR* InFilename, uint64 InOffset = 0, uint64 InSize = 0, void* InBuffer = nullptr);
+	static FAsyncIORequest Write(const TCHAR* InFilename, const void* InData, uint64 InSize, uint64 InOffset = 0, bool bInTruncate = false);
+};
+
+/**
+* Outcome of a FAsyncIORequest.
+*/
+struct FAsyncIOResult
+{
+	bool				bSucceeded;
+
+	/** Bytes read or written. */
+	uint64				BytesTransferred;
+
+	/** The bytes read if the request had no buffer. */
+	std::vector<uint8>	Data;
+
+	FAsyncIOResult()
+		: bSucceeded(false)
+		, BytesTransferred(0)
+	{}
+};
+
+/**
+* Asynchronous file reads and writes.
+*
+* Requests complete through futures bound to a thread pool, so continuations
+* added with Then run on the pool once the data is there and no pool thread
+* blocks in a read meanwhile:
+*	IO->Submit(FAsyncIORequest::Read(TEXT("a.bin"))).Then([](const FAsyncIOResult& Result){ ... });
+*
+* A task group, or a graph node waiting on one, waits for requests that name it
+* as their CompletionGroup:
+*	Request.CompletionGroup = &Group;
+*	IO->Submit(Request);
+*	Group.Wait();
+*/
+class IAsyncFileIO
+{
+public:
+	virtual ~IAsyncFileIO() {}
+
+	/**
+	* Submits requests together, which costs one queue lock and one wake up for the whole batch.
+	*
+	* @param Requests The requests, executed in no particular order
+	* @return One future per request, in the order of the requests.
+	*/
+	virtual std::vector<TFuture<FAsyncIOResult>> SubmitBatch(std::vector<FAsyncIORequest> Requests) = 0;
+
+	/** @return The number of requests not completed yet. */
+	virtual int32 GetNumPending() const = 0;
+
+	/**
+	* Submits a single request.
+	*
+	* @return A future for the result.
+	*/
+	TFuture<FAsyncIOResult> Submit(FAsyncIORequest Request);
+
+	/**
+	* Creates the native implementation if the platform supports it, the threaded one otherwise.
+	*
+	* @param CompletionPool The pool continuations of the results run on, GThreadPool if nullptr
+	*/
+	static IAsyncFileIO* Create(FQueuedThreadPool* CompletionPool = nullptr);
+
+	/**
+	* Creates the native implementation: the requests are issued as overlapped reads and writes
+	* and their completions are collected from an I/O completion port by a single thread, so no
+	* thread blocks per request in flight. That thread also opens the files, a batch is handed
+	* to it in one packet and the submitting thread never blocks in the file system. Deleting it
+	* waits for the requests in flight.
+	*
+	* @param CompletionPool The pool continuations of the results run on, GThreadPool if nullptr
+	* @return The implementation, nullptr if no completion port could be created.
+	*/
+	static IAsyncFileIO* CreateOverlapped(FQueuedThreadPool* CompletionPool = nullptr);
+
+	/**
+	* Creates the portable implementation, executing the requests on dedicated I/O threads
+	* so that blocking system calls never occupy a pool thread. Requests still pending when
+	* it is deleted complete as failed.
+	*
+	* @param NumIOThreads Number of I/O threads, bounds the number of requests in flight
+	* @param CompletionPool The pool continuations of the results run on, GThreadPool if nullptr
+	*/
+	static IAsyncFileIO* CreateThreaded(int32 NumIOThreads = 2, FQueuedThreadPool* CompletionPool = nullptr);
+};
@@ -1,9 +1,42 @@
+#include <cstring>
 #include <iostream>
+#include "Benchmark/ScalabilityHarness.h"
+#include "Thread/QueuedThreadPool.h"
 
 using namespace std;
 
-int main()
+int main(int argc, char* argv[])
 {
-	cout << "hello world!" << endl;
-	return 0;
-}
\ No newline at end of file
+	// Must be decided before the first thread is created
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-nothreading") == 0)
+		{
+			FPlatformProcess::SetSupportsMultithreading(false);
+		}
+	}
+
+	// The default pool of futures, pipes, groups, graphs and file I/O
+	GThreadPool = FQueuedThreadPool::Allocate();
+	GThreadPool->Create(FPlatformProcess::NumberOfCores());
+
+	int ExitCode = 0;
+	bool bRanHarness = false;
+	for (int i = 1; i < argc && !bRanHarness; i++)
+	{
+		if (strcmp(argv[i], "-stress") == 0)
+		{
+			ExitCode = FScalabilityHarness::RunFromCommandLine(argc, argv);
+			bRanHarness = true;
+		}
+	}
+	if (!bRanHarness)
+	{
+		cout << "hello world!" << endl;
+	}
+
+	GThreadPool->Destory();
+	delete GThreadPool;
+	GThreadPool = nullptr;
+	return ExitCode;
+}
@@ -0,0 +1,332 @@
+#include <cassert>
+#include "IncrementalTaskGraph.h"
+#include "../HAL/Event.h"
+#include "../Thread/IQueuedWork.h"
+#include "../Thread/LockProfiler.h"
+#include "../Thread/QueuedThreadPool.h"
+#include "../Thread/TaskGroup.h"
+
+/////////////////////////////////////Node/////////////////////////////////////
+class FIncrementalTaskGraph::FNode final : public IQueuedWork
+{
+public:
+	FNode(FIncrementalTaskGraph* InGraph, FNodeId InNodeId, FComputeFunction InCompute)
+		: Graph(InGraph)
+		, NodeId(InNodeId)
+		, Compute(std::move(InCompute))
+		, Height(0)
+		, OutputHash(0)
+		, bComputed(false)
+		, bDirty(true)
+		, bReached(false)
+		, bOutputChanged(false)
+	{}
+
+	virtual void DoThreadedWork() override
+	{
+		Graph->ExecuteNode(NodeId);
+		Graph->CompleteQueuedNode();
+	}
+
+	virtual void Abandon() override
+	{
+		// The pool is shutting down, leave the node to the calling thread
+		{
+			SCOPE_LOCK(&Graph->InlineNodesCritical);
+			Graph->InlineNodes.push_back(NodeId);
+		}
+		Graph->CompleteQueuedNode();
+	}
+
+	FIncrementalTaskGraph*	Graph;
+	FNodeId					NodeId;
+	FComputeFunction		Compute;
+	std::vector<FNodeId>	Successors;
+
+	/** Above the height of every prerequisite. */
+	int32					Height;
+
+	/** Hash of the output from the last time the node was computed. */
+	uint64					OutputHash;
+	bool					bComputed;
+
+	/** Whether the node is recomputed by the next execution regardless of its inputs. */
+	bool					bDirty;
+
+	/** Whether the current execution recomputes the node. */
+	bool					bReached;
+
+	/** Whether the last computation changed the output, read once the level completed. */
+	bool					bOutputChanged;
+};
+
+/////////////////////////////////////Incremental Task Graph/////////////////////////////////////
+FIncrementalTaskGraph::FIncrementalTaskGraph(FQueuedThreadPool* InThreadPool /*= nullptr*/)
+	: MaxHeight(0)
+	, ThreadPool(InThreadPool ? InThreadPool : GThreadPool)
+	, NumPendingNodes(0)
+	, bExecuting(false)
+	, CompletionEvent(nullptr)
+{
+	assert(ThreadPool);
+}
+
+FIncrementalTaskGraph::~FIncrementalTaskGraph()
+{
+	assert(!bExecuting && "Destroying an incremental task graph while it executes");
+	for (FNode* Node : Nodes)
+	{
+		delete Node;
+	}
+	delete CompletionEvent.load();
+}
+
+FIncrementalTaskGraph::FNodeId FIncrementalTaskGraph::AddNode(FComputeFunction Compute)
+{
+	assert(!bExecuting);
+	const FNodeId NodeId = (FNodeId)Nodes.size();
+	Nodes.push_back(new FNode(this, NodeId, std::move(Compute)));
+	DirtyNodes.push_back(NodeId);
+	return NodeId;
+}
+
+bool FIncrementalTaskGraph::AddDependency(FNodeId Prerequisite, FNodeId Dependent)
+{
+	assert(!bExecuting);
+	assert(Prerequisite >= 0 && Prerequisite < GetNumNodes() && Dependent >= 0 && Dependent < GetNumNodes());
+	if (Reaches(Dependent, Prerequisite))
+	{
+		return false;
+	}
+	Nodes[Prerequisite]->Successors.push_back(Dependent);
+	RaiseHeight(Dependent, Nodes[Prerequisite]->Height + 1);
+	MarkDirty(Dependent);
+	return true;
+}
+
+void FIncrementalTaskGraph::MarkDirty(FNodeId Node)
+{
+	assert(!bExecuting && "Inputs cannot change while the graph executes");
+	assert(Node >= 0 && Node < GetNumNodes());
+	if (!Nodes[Node]->bDirty)
+	{
+		Nodes[Node]->bDirty = true;
+		DirtyNodes.push_back(Node);
+	}
+}
+
+bool FIncrementalTaskGraph::IsDirty(FNodeId Node) const
+{
+	assert(Node >= 0 && Node < GetNumNodes());
+	return Nodes[Node]->bDirty;
+}
+
+uint64 FIncrementalTaskGraph::GetOutputHash(FNodeId Node) const
+{
+	assert(Node >= 0 && Node < GetNumNodes());
+	return Nodes[Node]->OutputHash;
+}
+
+void FIncrementalTaskGraph::RaiseHeight(FNodeId NodeId, int32 Height)
+{
+	// Only paths whose height grows are followed, the graph is acyclic so this ends
+	std::vector<std::pair<FNodeId, int32>> Stack(1, std::make_pair(NodeId, Height));
+	while (!Stack.empty())
+	{
+		const std::pair<FNodeId, int32> Raise = Stack.back();
+		Stack.pop_back();
+		FNode& Node = *Nodes[Raise.first];
+		if (Node.Height >= Raise.second)
+		{
+			continue;
+		}
+		Node.Height = Raise.second;
+		if (Node.Height > MaxHeight)
+		{
+			MaxHeight = Node.Height;
+		}
+		for (FNodeId Successor : Node.Successors)
+		{
+			Stack.push_back(std::make_pair(Successor, Node.Height + 1));
+		}
+	}
+}
+
+bool FIncrementalTaskGraph::Reaches(FNodeId From, FNodeId To) const
+{
+	std::vector<bool> Visited(Nodes.size(), false);
+	std::vector<FNodeId> Stack(1, From);
+	Visited[From] = true;
+	while (!Stack.empty())
+	{
+		const FNodeId NodeId = Stack.back();
+		Stack.pop_back();
+		if (NodeId == To)
+		{
+			return true;
+		}
+		for (FNodeId Successor : Nodes[NodeId]->Successors)
+		{
+			if (!Visited[Successor])
+			{
+				Visited[Successor] = true;
+				Stack.push_back(Successor);
+			}
+		}
+	}
+	return false;
+}
+
+FIncrementalExecutionStats FIncrementalTaskGraph::Execute()
+{
+	assert(!bExecuting && "An incremental task graph can only execute once at a time");
+	bExecuting = true;
+
+	FIncrementalExecutionStats Stats;
+	if (ReachedNodes.size() < (size_t)MaxHeight + 1)
+	{
+		ReachedNodes.resize((size_t)MaxHeight + 1);
+	}
+	for (FNodeId NodeId : DirtyNodes)
+	{
+		ReachNode(NodeId);
+	}
+	DirtyNodes.clear();
+
+	// Every dependent is higher than its prerequisites, so a height is complete before the next one starts
+	for (size_t Height = 0; Height < ReachedNodes.size(); ++Height)
+	{
+		std::vector<FNodeId>& Level = ReachedNodes[Height];
+		if (Level.empty())
+		{
+			continue;
+		}
+		ExecuteLevel(Level);
+
+		// Only the dependents of changed outputs go on, nothing past a cut off node is visited
+		for (FNodeId NodeId : Level)
+		{
+			FNode& Node = *Nodes[NodeId];
+			Node.bReached = false;
+			if (!Node.bOutputChanged)
+			{
+				++Stats.NumCutoff;
+				continue;
+			}
+			for (FNodeId Successor : Node.Successors)
+			{
+				ReachNode(Successor);
+			}
+		}
+		Stats.NumAffected += (int32)Level.size();
+		Level.clear();
+	}
+	// Every reached node is computed, refused and abandoned ones by this thread
+	Stats.NumExecuted = Stats.NumAffected;
+
+	bExecuting = false;
+	return Stats;
+}
+
+void FIncrementalTaskGraph::ReachNode(FNodeId NodeId)
+{
+	FNode& Node = *Nodes[NodeId];
+	if (!Node.bReached)
+	{
+		Node.bReached = true;
+		ReachedNodes[Node.Height].push_back(NodeId);
+	}
+}
+
+void FIncrementalTaskGraph::ExecuteLevel(const std::vector<FNodeId>& Level)
+{
+	if (Level.size() == 1)
+	{
+		// Nothing to run in parallel, a round trip through the pool would only add latency
+		ExecuteNode(Level[0]);
+		return;
+	}
+
+	FEvent* Event = CompletionEvent.load();
+	if (Event != nullptr)
+	{
+		Event->Reset();
+	}
+	// All counted before any is queued, so that a queued one cannot complete the level early
+	NumPendingNodes.store((int32)Level.size() - 1);
+	for (size_t Index = 1; Index < Level.size(); ++Index)
+	{
+		if (ThreadPool->QueuedThreadWork(Nodes[Level[Index]]) == EQueuedWorkResult::Rejected)
+		{
+			{
+				SCOPE_LOCK(&InlineNodesCritical);
+				InlineNodes.push_back(Level[Index]);
+			}
+			CompleteQueuedNode();
+		}
+	}
+	ExecuteNode(Level[0]);
+
+	size_t NumUnclaimed = Level.size();
+	FHelpingWait::Wait(ThreadPool, CompletionEvent, [this]()
+	{
+		return NumPendingNodes.load(std::memory_order_acquire) == 0;
+	}, [this, &Level, &NumUnclaimed]()
+	{
+		// Nodes still queued are taken back and computed here, newest first
+		while (NumUnclaimed > 1)
+		{
+			FNode* Node = Nodes[Level[--NumUnclaimed]];
+			if (ThreadPool->RetractQueuedWork(Node))
+			{
+				Node->DoThreadedWork();
+				return true;
+			}
+		}
+		return false;
+	});
+	// The last node may still be triggering the event
+	{
+		SCOPE_LOCK(&CompletionCritical);
+	}
+
+	// Nothing else touches the nodes the pool refused or abandoned anymore
+	for (FNodeId NodeId : InlineNodes)
+	{
+		ExecuteNode(NodeId);
+	}
+	InlineNodes.clear();
+}
+
+void FIncrementalTaskGraph::ExecuteNode(FNodeId NodeId)
+{
+	FNode& Node = *Nodes[NodeId];
+	const uint64 OutputHash = Node.Compute();
+	Node.bOutputChanged = !Node.bComputed || OutputHash != Node.OutputHash;
+	Node.OutputHash = OutputHash;
+	Node.bComputed = true;
+	Node.bDirty = false;
+}
+
+void FIncrementalTaskGraph::CompleteQueuedNode()
+{
+	int32 Pending = NumPendingNodes.load(std::memory_order_relaxed);
+	while (Pending > 1)
+	{
+		if (NumPendingNodes.compare_exchange_weak(Pending, Pending - 1, std::memory_order_acq_rel))
+		{
+			return;
+		}
+	}
+
+	// The last node completes under the lock the level takes before it ends, the graph may be reused afterwards
+	SCOPE_LOCK(&CompletionCritical);
+	if (NumPendingNodes.fetch_sub(1, std::memory_order_acq_rel) == 1)
+	{
+		FEvent* Event = CompletionEvent.load();
+		if (Event != nullptr)
+		{
+			Event->Trigger();
+		}
+	}
+}
@@ -0,0 +1,178 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <vector>
+#include "TaskGraphTypes.h"
+
+class FEvent;
+class FQueuedThreadPool;
+
+/** What an execution of a FIncrementalTaskGraph did. */
+struct FIncrementalExecutionStats
+{
+	/** Nodes that were dirty or had an input change. */
+	int32 NumAffected;
+
+	/** Nodes whose compute function ran. */
+	int32 NumExecuted;
+
+	/** Executed nodes whose output did not change, so their dependents were left alone. */
+	int32 NumCutoff;
+
+	FIncrementalExecutionStats()
+		: NumAffected(0)
+		, NumExecuted(0)
+		, NumCutoff(0)
+	{}
+};
+
+/**
+* A persistent task graph that re-executes only what changed.
+*
+* Every node has a compute function that stores its output where its dependents
+* read it and returns a hash of that output; the graph keeps the hash. Inputs
+* are marked dirty between executions and Execute recomputes the dirty nodes and
+* the nodes depending on them, in parallel on the pool. A node whose recomputed
+* hash did not change does not invalidate its dependents (early cutoff), so an
+* execution usually stops well short of the full downstream graph.
+*
+* Every node has a height above all of its prerequisites, kept up to date as
+* dependencies are added. Execute recomputes the nodes it reached one height after
+* the other, the nodes of one height in parallel, and only the dependents of nodes
+* whose output changed are reached, so nothing past a cut off node is visited.
+* Nodes the pool refused or abandoned are computed by the calling thread, so
+* every execution leaves no node dirty.
+*
+* Nodes and dependencies can be added between executions, never during one.
+* New nodes are dirty until they were computed once.
+*/
+class FIncrementalTaskGraph
+{
+public:
+	typedef int32 FNodeId;
+
+	/** Recomputes and stores the output of a node, returns a hash of the output. */
+	typedef std::function<uint64()> FComputeFunction;
+
+	/**
+	* @param InThreadPool The pool executing the nodes, GThreadPool if nullptr
+	*/
+	explicit FIncrementalTaskGraph(FQueuedThreadPool* InThreadPool = nullptr);
+	~FIncrementalTaskGraph();
+
+	FIncrementalTaskGraph(const FIncrementalTaskGraph&) = delete;
+	FIncrementalTaskGraph& operator=(const FIncrementalTaskGraph&) = delete;
+
+	/**
+	* Adds a node, dirty until its first execution.
+	*
+	* @param Compute The function computing the output of the node
+	* @return The id of the node.
+	*/
+	FNodeId AddNode(FComputeFunction Compute);
+
+	/**
+	* Adds a node caching a value, hashed with std::hash.
+	*
+	* @param Output Where the value is stored, must outlive the graph
+	* @param Function Computes the value
+	* @return The id of the node.
+	*/
+	template<typename ValueType, typename FunctionType>
+	FNodeId AddCachedNode(ValueType& Output, FunctionType Function)
+	{
+		ValueType* OutputPtr = &Output;
+		return AddNode([OutputPtr, Function]() -> uint64
+		{
+			*OutputPtr = Function();
+			return (uint64)std::hash<ValueType>()(*OutputPtr);
+		});
+	}
+
+	/**
+	* Makes a node depend on the output of another, the dependent becomes dirty.
+	*
+	* @param Prerequisite The node whose output is read
+	* @param Dependent The node reading it
+	* @return false if the dependency would form a cycle, it is not added then.
+	*/
+	bool AddDependency(FNodeId Prerequisite, FNodeId Dependent);
+
+	/**
+	* Marks the input of a node as changed, it is recomputed by the next execution.
+	*
+	* @param Node The node
+	*/
+	void MarkDirty(FNodeId Node);
+
+	/** @return true if the node is recomputed by the next execution. */
+	bool IsDirty(FNodeId Node) const;
+
+	/** @return The hash of the output of the node from the last time it was computed. */
+	uint64 GetOutputHash(FNodeId Node) const;
+
+	int32 GetNumNodes() const
+	{
+		return (int32)Nodes.size();
+	}
+
+	/**
+	* Recomputes the dirty nodes and whatever they invalidate, and waits for it.
+	* The calling thread takes part and helps with pool work while waiting.
+	*
+	* @return What the execution did.
+	*/
+	FIncrementalExecutionStats Execute();
+
+private:
+	class FNode;
+
+	/** Adds a node to the nodes the current execution recomputes, once. */
+	void ReachNode(FNodeId NodeId);
+
+	/** Recomputes the reached nodes of one height, on the pool and the calling thread, and waits for them. */
+	void ExecuteLevel(const std::vector<FNodeId>& Level);
+
+	/** Recomputes a node and stores whether its output changed. */
+	void ExecuteNode(FNodeId NodeId);
+
+	/** Drops the count of a node queued on the pool, completing the level with the last one. */
+	void CompleteQueuedNode();
+
+	/** Raises the height of a node and of its dependents, so that every node stays above its prerequisites. */
+	void RaiseHeight(FNodeId NodeId, int32 Height);
+
+	/** @return true if From is To or reaches it through dependencies. */
+	bool Reaches(FNodeId From, FNodeId To) const;
+
+	/** Owned nodes, indexed by id. */
+	std::vector<FNode*>	Nodes;
+
+	/** Nodes marked dirty since the last execution. */
+	std::vector<FNodeId> DirtyNodes;
+
+	/** The nodes the current execution reached, by height, kept between executions so they do not allocate. */
+	std::vector<std::vector<FNodeId>> ReachedNodes;
+
+	/** Queued nodes of the current level the pool refused or abandoned, the calling thread computes them. */
+	std::vector<FNodeId> InlineNodes;
+	FCriticalSection	InlineNodesCritical;
+
+	/** The largest height of any node. */
+	int32				MaxHeight;
+
+	/** The pool executing the nodes. */
+	FQueuedThreadPool*	ThreadPool;
+
+	/** Nodes of the current level queued on the pool and not computed yet. */
+	std::atomic<int32>	NumPendingNodes;
+
+	/** Whether Execute is running, nodes and inputs cannot change meanwhile. */
+	bool				bExecuting;
+
+	/** Triggered when the last queued node of a level completes, created by the first wait that blocks. */
+	std::atomic<FEvent*> CompletionEvent;
+
+	/** Held while the last queued node completes, so a level cannot end while the event is triggered. */
+	FCriticalSection	CompletionCritical;
+};
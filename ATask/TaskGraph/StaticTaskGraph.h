@@ -0,0 +1,555 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <functional>
+#include "TaskDurationStats.h"
+#include "TaskGraphTypes.h"
+#include "../HAL/Event.h"
+#include "../Thread/IQueuedWork.h"
+#include "../Thread/LockProfiler.h"
+#include "../Thread/QueuedThreadPool.h"
+#include "../Thread/TaskGroup.h"
+
+/**
+* Dependency data of a task graph whose shape is known at compile time.
+*
+* Prerequisite counts, successor lists and a topological order are computed
+* as constexpr data, so executing the graph never has to build or walk
+* per run dependency lists.
+*
+* @param InNumNodes Number of nodes in the graph, nodes are identified by their index
+* @param Edges List of TStaticTaskEdge describing the dependencies
+*/
+template<int32 InNumNodes, typename... Edges>
+struct TStaticTaskGraphLayout
+{
+	static_assert(InNumNodes > 0, "A static task graph needs at least one node");
+
+	static const int32 NumNodes = InNumNodes;
+	static const int32 NumEdges = sizeof...(Edges);
+
+	struct FData
+	{
+		/** Number of prerequisites of each node. */
+		int32 NumPrerequisites[NumNodes];
+
+		/** Successors of node N are Successors[FirstSuccessor[N]] to Successors[FirstSuccessor[N + 1] - 1]. */
+		int32 FirstSuccessor[NumNodes + 1];
+		int32 Successors[NumEdges + 1];
+
+		/** All nodes in dependency order, the first NumRoots entries have no prerequisites. */
+		int32 TopologicalOrder[NumNodes];
+		int32 NumRoots;
+
+		/** Whether all edges reference existing nodes. */
+		bool bEdgesInRange;
+
+		/** Whether the graph has no dependency cycle. */
+		bool bIsAcyclic;
+	};
+
+	static constexpr FData Build()
+	{
+		FData Data{};
+		// One trailing entry so that an edge-less graph does not declare empty arrays
+		const int32 From[NumEdges + 1] = { Edges::From..., -1 };
+		const int32 To[NumEdges + 1] = { Edges::To..., -1 };
+
+		Data.bEdgesInRange = true;
+		for (int32 Edge = 0; Edge < NumEdges; ++Edge)
+		{
+			if (From[Edge] < 0 || From[Edge] >= NumNodes || To[Edge] < 0 || To[Edge] >= NumNodes)
+			{
+				Data.bEdgesInRange = false;
+				return Data;
+			}
+		}
+
+		// Counts and successor lists in compressed row form
+		for (int32 Edge = 0; Edge < NumEdges; ++Edge)
+		{
+			++Data.NumPrerequisites[To[Edge]];
+			++Data.FirstSuccessor[From[Edge] + 1];
+		}
+		for (int32 Node = 0; Node < NumNodes; ++Node)
+		{
+			Data.FirstSuccessor[Node + 1] += Data.FirstSuccessor[Node];
+		}
+		int32 NumFilled[NumNodes] = {};
+		for (int32 Edge = 0; Edge < NumEdges; ++Edge)
+		{
+			Data.Successors[Data.FirstSuccessor[From[Edge]] + NumFilled[From[Edge]]++] = To[Edge];
+		}
+
+		// Kahn's algorithm, using the order itself as the work queue
+		int32 NumPending[NumNodes] = {};
+		int32 Count = 0;
+		for (int32 Node = 0; Node < NumNodes; ++Node)
+		{
+			NumPending[Node] = Data.NumPrerequisites[Node];
+			if (NumPending[Node] == 0)
+			{
+				Data.TopologicalOrder[Count++] = Node;
+			}
+		}
+		Data.NumRoots = Count;
+		for (int32 Head = 0; Head < Count; ++Head)
+		{
+			const int32 Node = Data.TopologicalOrder[Head];
+			for (int32 Index = Data.FirstSuccessor[Node]; Index < Data.FirstSuccessor[Node + 1]; ++Index)
+			{
+				if (--NumPending[Data.Successors[Index]] == 0)
+				{
+					Data.TopologicalOrder[Count++] = Data.Successors[Index];
+				}
+			}
+		}
+		Data.bIsAcyclic = (Count == NumNodes);
+		return Data;
+	}
+
+	static constexpr FData Data = Build();
+
+	static_assert(Data.bEdgesInRange, "A static task graph edge references a node index out of range");
+	static_assert(Data.bIsAcyclic, "A static task graph must not contain a dependency cycle");
+};
+
+template<int32 InNumNodes, typename... Edges>
+constexpr typename TStaticTaskGraphLayout<InNumNodes, Edges...>::FData TStaticTaskGraphLayout<InNumNodes, Edges...>::Data;
+
+
+/**
+* A task graph with a fixed, compile time shape that can be executed many times.
+*
+* Node state lives in one contiguous array owned by the graph, executing the
+* graph only resets the prerequisite counters from the constexpr layout and
+* allocates nothing. Tasks are bound once with SetTask.
+*
+* A thread finishing a node continues with its successor if exactly one became
+* ready, without taking any lock. When several become ready at once it continues
+* with the one ranking highest by estimated remaining critical path, the longest
+* sum of estimated durations from the node to a sink, and the others go to a ready
+* heap that queued tickets and threads running out of work take the highest
+* ranking node from. Durations are measured into FTaskTypeStats in one execution
+* out of RankingInterval and the ranks are recomputed from them in the next, so
+* the long chain of a graph starts first and short independent work fills the gaps
+* while most executions neither time their nodes nor walk the graph.
+*
+* Usage:
+*	typedef TStaticTaskGraphLayout<3, TStaticTaskEdge<0, 2>, TStaticTaskEdge<1, 2>> FMyLayout;
+*	TStaticTaskGraph<FMyLayout> Graph;
+*	Graph.SetTask(0, [](){ ... }, "Physics");
+*	Graph.Execute();
+*
+* @param LayoutType A TStaticTaskGraphLayout
+*/
+template<typename LayoutType>
+class TStaticTaskGraph
+{
+public:
+	static const int32 NumNodes = LayoutType::NumNodes;
+
+	/**
+	* @param InThreadPool The pool executing the nodes, GThreadPool if nullptr
+	*/
+	explicit TStaticTaskGraph(FQueuedThreadPool* InThreadPool = nullptr)
+		: NumReadyNodes(0)
+		, ThreadPool(InThreadPool ? InThreadPool : GThreadPool)
+		, ExecutionsUntilMeasuring(1)
+		, bMeasureDurations(false)
+		, bRanksStale(true)
+		, NumOutstanding(0)
+		, CompletionEvent(nullptr)
+	{
+		assert(ThreadPool);
+		for (int32 Index = 0; Index < NumNodes; ++Index)
+		{
+			Nodes[Index].TypeStats = &Nodes[Index].LocalTypeStats;
+			Nodes[Index].CriticalPathSeconds = 0.0;
+			Tickets[Index].Graph = this;
+			Tickets[Index].bQueued.store(false, std::memory_order_relaxed);
+		}
+	}
+
+	~TStaticTaskGraph()
+	{
+		assert(NumOutstanding.load() == 0 && "Destroying a static task graph while it executes");
+		delete CompletionEvent.load();
+	}
+
+	/**
+	* Binds the function executed by a node, must not be called while the graph executes.
+	*
+	* @param NodeIndex The node index
+	* @param InTask The function to execute
+	* @param TaskTypeName Name the durations of the task are recorded under, shared by all tasks of
+	*	the same name across graphs. If nullptr the node records its durations on its own.
+	*/
+	void SetTask(int32 NodeIndex, std::function<void()> InTask, const char* TaskTypeName = nullptr)
+	{
+		assert(NodeIndex >= 0 && NodeIndex < NumNodes);
+		FNode& Node = Nodes[NodeIndex];
+		Node.Task = std::move(InTask);
+		Node.TypeStats = TaskTypeName ? FTaskDurationStats::Get().FindOrAdd(TaskTypeName) : &Node.LocalTypeStats;
+		// Measure the new task on the next execution and rank by it on the one after
+		ExecutionsUntilMeasuring = 1;
+		bRanksStale = true;
+	}
+
+	/**
+	* Executes all nodes on the pool and waits for them to complete, ranking them again first
+	* if the previous execution measured the durations. The calling thread executes the
+	* highest ranking root itself, then takes the tickets of the graph
+	* still queued back from the pool and executes them, and helps with pool work while waiting.
+	*/
+	void Execute()
+	{
+		assert(ThreadPool);
+		assert(NumOutstanding.load() == 0 && "A static task graph can only execute once at a time");
+		if (bRanksStale)
+		{
+			UpdateCriticalPaths();
+			bRanksStale = false;
+		}
+		bMeasureDurations = --ExecutionsUntilMeasuring == 0;
+		if (bMeasureDurations)
+		{
+			ExecutionsUntilMeasuring = RankingInterval;
+			bRanksStale = true;
+		}
+		FEvent* Event = CompletionEvent.load();
+		if (Event != nullptr)
+		{
+			Event->Reset();
+		}
+		for (int32 Index = 0; Index < NumNodes; ++Index)
+		{
+			Nodes[Index].NumPendingPrerequisites.store(LayoutType::Data.NumPrerequisites[Index], std::memory_order_relaxed);
+		}
+		// Every node and every queued ticket holds one count until it is done. The ticket counts are
+		// taken before the roots are published, a ticket may otherwise arrive after the last node completed.
+		NumOutstanding.store(NumNodes + LayoutType::Data.NumRoots - 1);
+
+		{
+			SCOPE_LOCK(&ReadyCritical);
+			for (int32 Root = 0; Root < LayoutType::Data.NumRoots; ++Root)
+			{
+				PushReadyNode(LayoutType::Data.TopologicalOrder[Root]);
+			}
+		}
+		for (int32 Root = 1; Root < LayoutType::Data.NumRoots; ++Root)
+		{
+			QueueTicket(LayoutType::Data.TopologicalOrder[Root]);
+		}
+		ExecuteReadyNodes(PopReadyNode(), true);
+
+		FHelpingWait::Wait(ThreadPool, CompletionEvent, [this]()
+		{
+			return NumOutstanding.load(std::memory_order_acquire) == 0;
+		}, [this]()
+		{
+			return TryExecuteQueuedTicket();
+		});
+		// The last node may still be triggering the event
+		{
+			SCOPE_LOCK(&CompletionCritical);
+		}
+	}
+
+	/** Executes all nodes on the calling thread, in topological order, without measuring their durations. */
+	void ExecuteSerial()
+	{
+		for (int32 Index = 0; Index < NumNodes; ++Index)
+		{
+			FNode& Node = Nodes[LayoutType::Data.TopologicalOrder[Index]];
+			if (Node.Task)
+			{
+				Node.Task();
+			}
+		}
+	}
+
+	/**
+	* @return The estimated duration of the longest dependency chain in seconds, as last ranked.
+	*/
+	double GetEstimatedCriticalPathSeconds() const
+	{
+		double CriticalPathSeconds = 0.0;
+		for (int32 Root = 0; Root < LayoutType::Data.NumRoots; ++Root)
+		{
+			CriticalPathSeconds = std::max(CriticalPathSeconds, Nodes[LayoutType::Data.TopologicalOrder[Root]].CriticalPathSeconds);
+		}
+		return CriticalPathSeconds;
+	}
+
+	/** Executions per duration measurement, the ranks are recomputed after each measurement. */
+	static const int32 RankingInterval = 16;
+
+private:
+	struct FNode
+	{
+		std::atomic<int32>	NumPendingPrerequisites;
+		std::function<void()> Task;
+
+		/** Where the durations of the task are recorded, LocalTypeStats unless the task type is named. */
+		FTaskTypeStats*		TypeStats;
+		FTaskTypeStats		LocalTypeStats;
+
+		/** Estimated seconds from the start of the node to the end of the graph. */
+		double				CriticalPathSeconds;
+	};
+
+	/**
+	* Queued on the pool for every node that becomes ready, executes the highest ranking
+	* ready node, which is not necessarily the one it was queued for.
+	*/
+	struct FTicket : public IQueuedWork
+	{
+		virtual void DoThreadedWork() override
+		{
+			bQueued.store(false, std::memory_order_relaxed);
+			Graph->ExecuteTicket(true);
+		}
+
+		virtual void Abandon() override
+		{
+			// The pool is shutting down, complete without running so that Execute returns
+			bQueued.store(false, std::memory_order_relaxed);
+			Graph->ExecuteTicket(false);
+		}
+
+		TStaticTaskGraph*	Graph;
+
+		/** Whether the ticket may be in the queue of the pool, so that Execute only tries to retract those. */
+		std::atomic<bool>	bQueued;
+	};
+
+	/** Ranks every node by the longest estimated path from it to a sink. */
+	void UpdateCriticalPaths()
+	{
+		for (int32 Order = NumNodes - 1; Order >= 0; --Order)
+		{
+			const int32 NodeIndex = LayoutType::Data.TopologicalOrder[Order];
+			double SuccessorPathSeconds = 0.0;
+			for (int32 Index = LayoutType::Data.FirstSuccessor[NodeIndex]; Index < LayoutType::Data.FirstSuccessor[NodeIndex + 1]; ++Index)
+			{
+				SuccessorPathSeconds = std::max(SuccessorPathSeconds, Nodes[LayoutType::Data.Successors[Index]].CriticalPathSeconds);
+			}
+			FNode& Node = Nodes[NodeIndex];
+			const double NodeSeconds = Node.Task ? Node.TypeStats->GetEstimatedSeconds() : 0.0;
+			Node.CriticalPathSeconds = NodeSeconds + SuccessorPathSeconds;
+		}
+	}
+
+	/** Runs the task of a node, recording its duration if the execution measures them. */
+	void RunTask(FNode& Node)
+	{
+		if (!Node.Task)
+		{
+			return;
+		}
+		if (!bMeasureDurations)
+		{
+			Node.Task();
+			return;
+		}
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		Node.Task();
+		Node.TypeStats->Record((double)(FPlatformTime::Cycles64() - StartCycles) * FPlatformTime::GetSecondsPerCycle64());
+	}
+
+	/** Orders the ready heap, the node with the longest remaining critical path on top. */
+	bool RanksLower(int32 A, int32 B) const
+	{
+		return Nodes[A].CriticalPathSeconds < Nodes[B].CriticalPathSeconds;
+	}
+
+	/** Adds a node to the ready heap, ReadyCritical must be held. */
+	void PushReadyNode(int32 NodeIndex)
+	{
+		const int32 NumReady = NumReadyNodes.load(std::memory_order_relaxed);
+		ReadyNodes[NumReady] = NodeIndex;
+		std::push_heap(ReadyNodes, ReadyNodes + NumReady + 1, [this](int32 A, int32 B) { return RanksLower(A, B); });
+		NumReadyNodes.store(NumReady + 1, std::memory_order_relaxed);
+	}
+
+	/** @return The highest ranking ready node, INDEX_NONE if there is none. */
+	int32 PopReadyNode()
+	{
+		// Every node in the heap has a ticket queued, one pushed concurrently and missed here is not lost
+		if (NumReadyNodes.load(std::memory_order_relaxed) == 0)
+		{
+			return INDEX_NONE;
+		}
+		SCOPE_LOCK(&ReadyCritical);
+		const int32 NumReady = NumReadyNodes.load(std::memory_order_relaxed);
+		if (NumReady == 0)
+		{
+			return INDEX_NONE;
+		}
+		std::pop_heap(ReadyNodes, ReadyNodes + NumReady, [this](int32 A, int32 B) { return RanksLower(A, B); });
+		NumReadyNodes.store(NumReady - 1, std::memory_order_relaxed);
+		return ReadyNodes[NumReady - 1];
+	}
+
+	/**
+	* Queues a ticket on the pool, the node only picks which of the ticket objects is free.
+	* The count of the ticket must be taken before the node was pushed to the ready heap.
+	* Called by a thread executing ready nodes, which takes the node itself if the queue refuses the ticket.
+	*/
+	void QueueTicket(int32 NodeIndex)
+	{
+		Tickets[NodeIndex].bQueued.store(true, std::memory_order_relaxed);
+		if (ThreadPool->QueuedThreadWork(&Tickets[NodeIndex]) == EQueuedWorkResult::Rejected)
+		{
+			// The ready node holds its own count, this cannot complete the execution
+			Tickets[NodeIndex].bQueued.store(false, std::memory_order_relaxed);
+			CompleteOutstanding();
+		}
+	}
+
+	/**
+	* Takes a ticket of the graph back from the queue of the pool and executes it, so that the
+	* execution never depends on a pool thread being free.
+	*
+	* @return true if a ticket was executed.
+	*/
+	bool TryExecuteQueuedTicket()
+	{
+		for (int32 Index = 0; Index < NumNodes; ++Index)
+		{
+			if (Tickets[Index].bQueued.load(std::memory_order_relaxed) && ThreadPool->RetractQueuedWork(&Tickets[Index]))
+			{
+				Tickets[Index].DoThreadedWork();
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void ExecuteTicket(bool bRunTask)
+	{
+		ExecuteReadyNodes(PopReadyNode(), bRunTask);
+		CompleteOutstanding();
+	}
+
+	/**
+	* Executes a node and continues with its successors, then with the highest ranking ready
+	* nodes, until there are none left.
+	*
+	* @param NodeIndex The node to start with, INDEX_NONE for none
+	*/
+	void ExecuteReadyNodes(int32 NodeIndex, bool bRunTask)
+	{
+		while (NodeIndex != INDEX_NONE)
+		{
+			if (bRunTask)
+			{
+				RunTask(Nodes[NodeIndex]);
+			}
+
+			// A single ready successor is continued with right away, only further ones go through the heap
+			int32 NextNodeIndex = INDEX_NONE;
+			for (int32 Index = LayoutType::Data.FirstSuccessor[NodeIndex]; Index < LayoutType::Data.FirstSuccessor[NodeIndex + 1]; ++Index)
+			{
+				int32 SuccessorIndex = LayoutType::Data.Successors[Index];
+				if (Nodes[SuccessorIndex].NumPendingPrerequisites.fetch_sub(1) != 1)
+				{
+					continue;
+				}
+				if (NextNodeIndex == INDEX_NONE)
+				{
+					NextNodeIndex = SuccessorIndex;
+					continue;
+				}
+				// This thread keeps the higher ranking of the two, the other one waits for a ticket
+				if (RanksLower(NextNodeIndex, SuccessorIndex))
+				{
+					std::swap(NextNodeIndex, SuccessorIndex);
+				}
+				NumOutstanding.fetch_add(1);
+				{
+					SCOPE_LOCK(&ReadyCritical);
+					PushReadyNode(SuccessorIndex);
+				}
+				QueueTicket(SuccessorIndex);
+			}
+
+			// Take the next node before completing this one, the graph may be reused once the last count is dropped.
+			// A ready node holds its own count, so completing this one cannot end the execution while there is one.
+			if (NextNodeIndex == INDEX_NONE)
+			{
+				NextNodeIndex = PopReadyNode();
+			}
+			if (CompleteOutstanding())
+			{
+				assert(NextNodeIndex == INDEX_NONE);
+				return;
+			}
+			NodeIndex = NextNodeIndex;
+		}
+	}
+
+	/**
+	* Drops one outstanding count, completing the execution with the last one.
+	*
+	* @return true if the execution completed, nothing may be touched afterwards since the graph may be reused.
+	*/
+	bool CompleteOutstanding()
+	{
+		int32 Outstanding = NumOutstanding.load(std::memory_order_relaxed);
+		while (Outstanding > 1)
+		{
+			if (NumOutstanding.compare_exchange_weak(Outstanding, Outstanding - 1, std::memory_order_acq_rel))
+			{
+				return false;
+			}
+		}
+
+		// The last count is dropped under the lock Execute takes before returning
+		SCOPE_LOCK(&CompletionCritical);
+		if (NumOutstanding.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			FEvent* Event = CompletionEvent.load();
+			if (Event != nullptr)
+			{
+				Event->Trigger();
+			}
+			return true;
+		}
+		return false;
+	}
+
+	/** State of all nodes, indexed by node. */
+	FNode				Nodes[NumNodes];
+
+	/** At most one ticket per node is queued per execution, so one object per node suffices. */
+	FTicket				Tickets[NumNodes];
+
+	/** Max heap of the ready nodes by remaining critical path, the count is written under ReadyCritical. */
+	int32				ReadyNodes[NumNodes];
+	std::atomic<int32>	NumReadyNodes;
+	FCriticalSection	ReadyCritical;
+
+	/** The pool executing the nodes. */
+	FQueuedThreadPool*	ThreadPool;
+
+	/** Executions left until the next one measures the durations of the nodes. */
+	int32				ExecutionsUntilMeasuring;
+
+	/** Whether the current execution measures the durations of the nodes. */
+	bool				bMeasureDurations;
+
+	/** Whether the durations were measured since the nodes were last ranked. */
+	bool				bRanksStale;
+
+	/** Nodes not completed and tickets not run yet in the current execution. */
+	std::atomic<int32>	NumOutstanding;
+
+	/** Triggered when the last node of an execution completes, created by the first wait that blocks. */
+	std::atomic<FEvent*> CompletionEvent;
+
+	/** Held while the last count is dropped, so Execute cannot return while the event is triggered. */
+	FCriticalSection	CompletionCritical;
+};
@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iomanip>
+#include "TaskDurationStats.h"
+#include "../Thread/LockProfiler.h"
+
+/////////////////////////////////////Task Type Stats/////////////////////////////////////
+const double FTaskTypeStats::DefaultEstimateSeconds = 1e-5;
+const double FTaskTypeStats::SmoothingFactor = 0.1;
+
+FTaskTypeStats::FTaskTypeStats(const char* InName /*= nullptr*/)
+	: Name(InName)
+	, NumSamples(0)
+	, AverageSeconds(0.0)
+	, MaxSeconds(0.0)
+{
+}
+
+void FTaskTypeStats::Record(double Seconds)
+{
+	// A plain mean over the first samples, so a cold estimate settles quickly
+	const uint64 SampleCount = NumSamples.fetch_add(1, std::memory_order_relaxed) + 1;
+	const double Weight = std::max(SmoothingFactor, 1.0 / (double)SampleCount);
+
+	double Average = AverageSeconds.load(std::memory_order_relaxed);
+	while (!AverageSeconds.compare_exchange_weak(Average, Average + (Seconds - Average) * Weight, std::memory_order_relaxed))
+	{
+	}
+
+	double Max = MaxSeconds.load(std::memory_order_relaxed);
+	while (Seconds > Max && !MaxSeconds.compare_exchange_weak(Max, Seconds, std::memory_order_relaxed))
+	{
+	}
+}
+
+double FTaskTypeStats::GetEstimatedSeconds() const
+{
+	if (NumSamples.load(std::memory_order_relaxed) == 0)
+	{
+		return DefaultEstimateSeconds;
+	}
+	return AverageSeconds.load(std::memory_order_relaxed);
+}
+
+void FTaskTypeStats::Reset()
+{
+	NumSamples.store(0, std::memory_order_relaxed);
+	AverageSeconds.store(0.0, std::memory_order_relaxed);
+	MaxSeconds.store(0.0, std::memory_order_relaxed);
+}
+
+/////////////////////////////////////Task Duration Stats/////////////////////////////////////
+FTaskTypeStats* FTaskDurationStats::FindOrAdd(const char* TaskTypeName)
+{
+	assert(TaskTypeName);
+	SCOPE_LOCK(&TaskTypesCritical);
+	for (FTaskTypeStats* TaskType : TaskTypes)
+	{
+		if (strcmp(TaskType->GetName(), TaskTypeName) == 0)
+		{
+			return TaskType;
+		}
+	}
+	TaskTypes.push_back(new FTaskTypeStats(TaskTypeName));
+	return TaskTypes.back();
+}
+
+void FTaskDurationStats::Dump(std::ostream& Output)
+{
+	std::vector<FTaskTypeStats*> SortedTaskTypes;
+	{
+		SCOPE_LOCK(&TaskTypesCritical);
+		SortedTaskTypes = TaskTypes;
+	}
+	std::sort(SortedTaskTypes.begin(), SortedTaskTypes.end(), [](const FTaskTypeStats* A, const FTaskTypeStats* B)
+	{
+		return A->GetEstimatedSeconds() > B->GetEstimatedSeconds();
+	});
+
+	Output << "Task durations:" << std::endl;
+	for (const FTaskTypeStats* TaskType : SortedTaskTypes)
+	{
+		Output << "  " << TaskType->GetName()
+			<< "  samples " << TaskType->GetNumSamples()
+			<< std::fixed << std::setprecision(1)
+			<< "  estimate " << TaskType->GetEstimatedSeconds() * 1e6 << "us"
+			<< "  max " << TaskType->GetMaxSeconds() * 1e6 << "us" << std::endl;
+	}
+}
+
+void FTaskDurationStats::Reset()
+{
+	SCOPE_LOCK(&TaskTypesCritical);
+	for (FTaskTypeStats* TaskType : TaskTypes)
+	{
+		TaskType->Reset();
+	}
+}
+
+FTaskDurationStats& FTaskDurationStats::Get()
+{
+	// Leaked on purpose, task types are referenced by graphs that may outlive static destruction
+	static FTaskDurationStats* Singleton = new FTaskDurationStats();
+	return *Singleton;
+}
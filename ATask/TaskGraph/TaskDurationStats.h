@@ -0,0 +1,99 @@
+#pragma once
+#include <atomic>
+#include <ostream>
+#include <vector>
+#include "../HAL/HAL.h"
+
+/**
+* Execution time statistics of one type of task.
+*
+* Keeps a moving average of the measured durations, which schedulers use as the
+* estimate of how long the next task of the type takes.
+*/
+class FTaskTypeStats
+{
+public:
+	/** Estimate used until a task of the type has been measured. */
+	static const double DefaultEstimateSeconds;
+
+	/** Weight of a new sample once the average has settled. */
+	static const double SmoothingFactor;
+
+	/**
+	* @param InName Name of the task type, must outlive the statistics
+	*/
+	explicit FTaskTypeStats(const char* InName = nullptr);
+
+	/**
+	* Records the duration of one execution.
+	*
+	* @param Seconds How long the task ran
+	*/
+	void Record(double Seconds);
+
+	/** @return The expected duration of the next execution in seconds. */
+	double GetEstimatedSeconds() const;
+
+	/** @return The longest recorded duration in seconds. */
+	double GetMaxSeconds() const
+	{
+		return MaxSeconds.load(std::memory_order_relaxed);
+	}
+
+	/** @return The number of recorded executions. */
+	uint64 GetNumSamples() const
+	{
+		return NumSamples.load(std::memory_order_relaxed);
+	}
+
+	const char* GetName() const
+	{
+		return Name;
+	}
+
+	/** Forgets all recorded durations. */
+	void Reset();
+
+private:
+	const char*				Name;
+	std::atomic<uint64>		NumSamples;
+	std::atomic<double>		AverageSeconds;
+	std::atomic<double>		MaxSeconds;
+};
+
+/**
+* Registry of the statistics of all named task types.
+*/
+class FTaskDurationStats
+{
+public:
+	/**
+	* Finds the statistics of a task type, adding them on first use.
+	* Look the type up once and keep the pointer, the statistics live as long as the process.
+	*
+	* @param TaskTypeName Name of the task type, must outlive the statistics
+	* @return The statistics of the type.
+	*/
+	FTaskTypeStats* FindOrAdd(const char* TaskTypeName);
+
+	/**
+	* Writes the statistics of all task types, longest estimate first.
+	*
+	* @param Output The stream to write to
+	*/
+	void Dump(std::ostream& Output);
+
+	/** Forgets the recorded durations of all task types. */
+	void Reset();
+
+	/**
+	* Access to the singleton object.
+	*
+	* @return Task duration statistics object.
+	*/
+	static FTaskDurationStats& Get();
+
+private:
+	std::vector<FTaskTypeStats*>	TaskTypes;
+	FCriticalSection				TaskTypesCritical;
+};
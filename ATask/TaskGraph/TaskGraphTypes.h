@@ -1 +1,13 @@
 #pragma once
+#include "../HAL/HAL.h"
+
+/**
+* A compile time dependency between two nodes of a static task graph,
+* the node at index To can only start once the node at index From has completed.
+*/
+template<int32 InFrom, int32 InTo>
+struct TStaticTaskEdge
+{
+	static const int32 From = InFrom;
+	static const int32 To = InTo;
+};
@@ -0,0 +1,286 @@
+#include "Future.h"
+#include "LockProfiler.h"
+#include "QueuedThreadPool.h"
+#include "TaskGroup.h"
+#include "../HAL/Event.h"
+
+/** Number of continuations the calling thread is nested in. */
+static uint32 GContinuationDepthTlsSlot = FPlatformTLS::AllocTlsSlot();
+
+int32 FFutureStateBase::MaxInlineContinuationDepth = 64;
+
+/////////////////////////////////////*Future State*/////////////////////////////////////
+FFutureStateBase::FFutureStateBase(FQueuedThreadPool* InThreadPool)
+	: RefCount(1)
+	, bComplete(false)
+	, Error(EFutureError::None)
+	, CompletionEvent(nullptr)
+	, ThreadPool(InThreadPool ? InThreadPool : GThreadPool)
+	, ProducerWork(nullptr)
+{
+	assert(ThreadPool);
+}
+
+FFutureStateBase::~FFutureStateBase()
+{
+	assert(Continuations.empty());
+	delete CompletionEvent.load();
+}
+
+void FFutureStateBase::Wait()
+{
+	FHelpingWait::Wait(ThreadPool, CompletionEvent, [this]()
+	{
+		return IsComplete();
+	}, [this]()
+	{
+		return TryExecuteProducerWork();
+	});
+}
+
+bool FFutureStateBase::TryExecuteProducerWork()
+{
+	FPromiseWorkBase* Work = ProducerWork.load(std::memory_order_acquire);
+	if (Work == nullptr || !ThreadPool->RetractQueuedWork(Work))
+	{
+		return false;
+	}
+	if (ProducerWork.load(std::memory_order_acquire) != Work)
+	{
+		// The producer ran and was deleted meanwhile, what was retracted is other work at its address
+		ThreadPool->QueuedThreadWork(Work, true);
+		return false;
+	}
+	Work->DoThreadedWork();
+	return true;
+}
+
+void FFutureStateBase::AddContinuation(FPromiseWorkBase* InWork)
+{
+	AddContinuationInternal(InWork, false);
+}
+
+void FFutureStateBase::AddInlineContinuation(IQueuedWork* InWork)
+{
+	AddContinuationInternal(InWork, true);
+}
+
+void FFutureStateBase::AddContinuationInternal(IQueuedWork* InWork, bool bExecuteInline)
+{
+	assert(InWork);
+	{
+		SCOPE_LOCK(&ContinuationsCritical);
+		if (!IsComplete())
+		{
+			Continuations.push_back(std::make_pair(InWork, bExecuteInline));
+			return;
+		}
+	}
+	ExecuteContinuation(InWork, bExecuteInline);
+}
+
+void FFutureStateBase::SetError(EFutureError InError)
+{
+	assert(InError != EFutureError::None);
+	assert(!IsComplete() && "A future can only complete once");
+	Error = InError;
+	MarkComplete();
+}
+
+void FFutureStateBase::MarkComplete()
+{
+	std::vector<std::pair<IQueuedWork*, bool>> CompletedContinuations;
+	{
+		SCOPE_LOCK(&ContinuationsCritical);
+		bComplete.store(true, std::memory_order_release);
+		CompletedContinuations.swap(Continuations);
+	}
+
+	FEvent* Event = CompletionEvent.load();
+	if (Event != nullptr)
+	{
+		Event->Trigger();
+	}
+
+	// Continuations hold a reference to this state, the last one may delete it
+	for (auto& Continuation : CompletedContinuations)
+	{
+		ExecuteContinuation(Continuation.first, Continuation.second);
+	}
+}
+
+void FFutureStateBase::ExecuteContinuation(IQueuedWork* InWork, bool bExecuteInline)
+{
+	// A continuation completing its promise starts the next one from within, count how deep that goes
+	const int32 Depth = (int32)(intptr_t)FPlatformTLS::GetTlsValue(GContinuationDepthTlsSlot);
+	const bool bTooDeep = Depth >= MaxInlineContinuationDepth;
+	FPlatformTLS::SetTlsValue(GContinuationDepthTlsSlot, (void*)(intptr_t)(Depth + 1));
+	if (bExecuteInline && !bTooDeep)
+	{
+		InWork->DoThreadedWork();
+	}
+	else if (ThreadPool->QueuedThreadWork(InWork, bTooDeep) == EQueuedWorkResult::Rejected)
+	{
+		// Past the capacity nothing is refused, so only promise works get here, a refused one completes its future instead
+		static_cast<FPromiseWorkBase*>(InWork)->Break(EFutureError::Rejected);
+	}
+	FPlatformTLS::SetTlsValue(GContinuationDepthTlsSlot, (void*)(intptr_t)Depth);
+}
+
+
+/////////////////////////////////////*Combinators*/////////////////////////////////////
+namespace FutureImpl
+{
+	/** State of a WhenAll, completes the promise once all futures are, with the first error if there was one. */
+	class FWhenAllState
+	{
+	public:
+		FWhenAllState(int32 InNumPending, TPromise<void>&& InPromise)
+			: NumPending(InNumPending)
+			, FirstError(EFutureError::None)
+			, Promise(std::move(InPromise))
+		{}
+
+		void OnComplete(EFutureError Error)
+		{
+			if (Error != EFutureError::None)
+			{
+				EFutureError Expected = EFutureError::None;
+				FirstError.compare_exchange_strong(Expected, Error);
+			}
+			if (NumPending.fetch_sub(1) == 1)
+			{
+				const EFutureError Result = FirstError.load();
+				if (Result != EFutureError::None)
+				{
+					Promise.SetError(Result);
+				}
+				else
+				{
+					Promise.SetValue();
+				}
+				delete this;
+			}
+		}
+
+	private:
+		std::atomic<int32>			NumPending;
+		std::atomic<EFutureError>	FirstError;
+		TPromise<void>				Promise;
+	};
+
+	class FWhenAllWork final : public IQueuedWork
+	{
+	public:
+		FWhenAllWork(FWhenAllState* InState, FFutureStateBase* InInput)
+			: State(InState)
+			, Input(InInput)
+		{}
+
+		virtual void DoThreadedWork() override
+		{
+			State->OnComplete(Input->GetError());
+			delete this;
+		}
+
+		virtual void Abandon() override
+		{
+			State->OnComplete(EFutureError::Abandoned);
+			delete this;
+		}
+
+	private:
+		FWhenAllState*		State;
+		/** The future this work was added to, alive while it runs its continuations. */
+		FFutureStateBase*	Input;
+	};
+
+	/** State of a WhenAny, completes the promise with the index of the first future completing. */
+	class FWhenAnyState
+	{
+	public:
+		FWhenAnyState(int32 InNumPending, TPromise<int32>&& InPromise)
+			: NumPending(InNumPending)
+			, bDone(false)
+			, Promise(std::move(InPromise))
+		{}
+
+		void OnComplete(int32 Index)
+		{
+			bool bExpected = false;
+			if (bDone.compare_exchange_strong(bExpected, true))
+			{
+				Promise.SetValue(Index);
+			}
+			if (NumPending.fetch_sub(1) == 1)
+			{
+				delete this;
+			}
+		}
+
+	private:
+		std::atomic<int32>	NumPending;
+		std::atomic<bool>	bDone;
+		TPromise<int32>		Promise;
+	};
+
+	class FWhenAnyWork final : public IQueuedWork
+	{
+	public:
+		FWhenAnyWork(FWhenAnyState* InState, int32 InIndex)
+			: State(InState)
+			, Index(InIndex)
+		{}
+
+		virtual void DoThreadedWork() override
+		{
+			State->OnComplete(Index);
+			delete this;
+		}
+
+		virtual void Abandon() override
+		{
+			DoThreadedWork();
+		}
+
+	private:
+		FWhenAnyState*	State;
+		int32			Index;
+	};
+}
+
+TFuture<void> WhenAll(const std::vector<FFutureStateBase*>& States)
+{
+	TPromise<void> Promise(States.empty() ? nullptr : States[0]->GetThreadPool());
+	TFuture<void> Future = Promise.GetFuture();
+	if (States.empty())
+	{
+		Promise.SetValue();
+		return Future;
+	}
+
+	FutureImpl::FWhenAllState* AllState = new FutureImpl::FWhenAllState((int32)States.size(), std::move(Promise));
+	for (FFutureStateBase* State : States)
+	{
+		State->AddInlineContinuation(new FutureImpl::FWhenAllWork(AllState, State));
+	}
+	return Future;
+}
+
+TFuture<int32> WhenAny(const std::vector<FFutureStateBase*>& States)
+{
+	TPromise<int32> Promise(States.empty() ? nullptr : States[0]->GetThreadPool());
+	TFuture<int32> Future = Promise.GetFuture();
+	if (States.empty())
+	{
+		Promise.SetValue((int32)INDEX_NONE);
+		return Future;
+	}
+
+	FutureImpl::FWhenAnyState* AnyState = new FutureImpl::FWhenAnyState((int32)States.size(), std::move(Promise));
+	for (int32 Index = 0; Index < (int32)States.size(); ++Index)
+	{
+		States[Index]->AddInlineContinuation(new FutureImpl::FWhenAnyWork(AnyState, Index));
+	}
+	return Future;
+}
@@ -0,0 +1,649 @@
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "../HAL/HAL.h"
+#include "IQueuedWork.h"
+#include "QueuedThreadPool.h"
+
+class FEvent;
+class FPromiseWorkBase;
+
+/**
+* Why a complete future has no value.
+*/
+enum class EFutureError
+{
+	/** The future has its value, or is not complete yet. */
+	None,
+
+	/** The queue of the pool was full and refused the work computing the value. */
+	Rejected,
+
+	/** The pool abandoned the work computing the value, it was shutting down or dropped it. */
+	Abandoned,
+
+	/** The promise was destroyed without setting the value. */
+	BrokenPromise
+};
+
+/**
+* Reference counted state shared by a TPromise and its TFutures.
+* Holds the completion flag and the continuations, the result lives in TFutureState.
+*/
+class FFutureStateBase
+{
+public:
+	/**
+	* @param InThreadPool The pool continuations are queued on and waiters help with, GThreadPool if nullptr
+	*/
+	explicit FFutureStateBase(FQueuedThreadPool* InThreadPool);
+	virtual ~FFutureStateBase();
+
+	void AddRef()
+	{
+		RefCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void Release()
+	{
+		if (RefCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			delete this;
+		}
+	}
+
+	/** @return true once the result or an error has been set. */
+	bool IsComplete() const
+	{
+		return bComplete.load(std::memory_order_acquire);
+	}
+
+	/** @return Why the state has no result, EFutureError::None while it is not complete. */
+	EFutureError GetError() const
+	{
+		return IsComplete() ? Error : EFutureError::None;
+	}
+
+	/**
+	* Completes the state without a result, releasing waiters and continuations.
+	*
+	* @param InError Why there is no result
+	*/
+	void SetError(EFutureError InError);
+
+	/**
+	* Waits for the result. While it is not set, the calling thread takes the work producing
+	* it back from the queue and executes it itself, or executes other work queued on the pool
+	* instead of sleeping, and only blocks when there is none or it is nested too deep in
+	* helping waits already (see FHelpingWait).
+	*/
+	void Wait();
+
+	/**
+	* Sets the work that completes the state once it runs, so that a waiter can execute it itself
+	* while it is queued. Set by the work when it is created and cleared when it starts.
+	*
+	* @param InWork The work, nullptr once it started
+	*/
+	void SetProducerWork(FPromiseWorkBase* InWork)
+	{
+		ProducerWork.store(InWork, std::memory_order_release);
+	}
+
+	/**
+	* Adds work to queue on the pool once the result is set, right away if it already is.
+	* The work is subject to the queue capacity, if the queue refuses it it completes with EFutureError::Rejected.
+	*
+	* @param InWork The work, owned as for FQueuedThreadPool::QueuedThreadWork
+	*/
+	void AddContinuation(FPromiseWorkBase* InWork);
+
+	/**
+	* Adds work to execute on the completing thread once the result is set, right away if it already is.
+	*
+	* @param InWork The work, owned as for FQueuedThreadPool::QueuedThreadWork
+	*/
+	void AddInlineContinuation(IQueuedWork* InWork);
+
+	/** @return The pool continuations are queued on. */
+	FQueuedThreadPool* GetThreadPool() const
+	{
+		return ThreadPool;
+	}
+
+	/**
+	* How many continuations may start nested in one another on one thread, inline or run inline
+	* by a full queue. Deeper continuations are queued past the queue capacity instead, so that a
+	* long Then chain does not grow the stack with its length.
+	*/
+	static int32 MaxInlineContinuationDepth;
+
+protected:
+	/** Publishes the result and releases waiters and continuations, called once the result is stored. */
+	void MarkComplete();
+
+private:
+	/** Adds a continuation or starts it if the result is set already. */
+	void AddContinuationInternal(IQueuedWork* InWork, bool bExecuteInline);
+
+	/** Starts a continuation. */
+	void ExecuteContinuation(IQueuedWork* InWork, bool bExecuteInline);
+
+	/**
+	* Takes the producer work back from the queue of the pool and executes it.
+	*
+	* @return false if it was not queued, it runs elsewhere, waits for its antecedent or is done.
+	*/
+	bool TryExecuteProducerWork();
+
+	std::atomic<int32>		RefCount;
+	std::atomic<bool>		bComplete;
+
+	/** Set before bComplete is published, read after it was. */
+	EFutureError			Error;
+
+	/** Created by the first waiter that has to block, nullptr until then. */
+	std::atomic<FEvent*>	CompletionEvent;
+
+	FQueuedThreadPool*		ThreadPool;
+
+	/** The work completing the state, nullptr once it started or if the result is set some other way. */
+	std::atomic<FPromiseWorkBase*> ProducerWork;
+
+	/** Continuations added before completion, with whether they execute inline. */
+	std::vector<std::pair<IQueuedWork*, bool>> Continuations;
+	FCriticalSection		ContinuationsCritical;
+};
+
+/**
+* Shared state holding the result inline, so setting a result allocates nothing.
+*/
+template<typename ResultType>
+class TFutureState : public FFutureStateBase
+{
+public:
+	explicit TFutureState(FQueuedThreadPool* InThreadPool)
+		: FFutureStateBase(InThreadPool)
+	{}
+
+	virtual ~TFutureState()
+	{
+		if (IsComplete() && GetError() == EFutureError::None)
+		{
+			GetResult().~ResultType();
+		}
+	}
+
+	template<typename... ArgTypes>
+	void EmplaceResult(ArgTypes&&... Args)
+	{
+		assert(!IsComplete() && "The result of a future can only be set once");
+		new (&Result) ResultType(std::forward<ArgTypes>(Args)...);
+		MarkComplete();
+	}
+
+	const ResultType& GetResult() const
+	{
+		return *reinterpret_cast<const ResultType*>(&Result);
+	}
+
+private:
+	typename std::aligned_storage<sizeof(ResultType), alignof(ResultType)>::type Result;
+};
+
+template<>
+class TFutureState<void> : public FFutureStateBase
+{
+public:
+	explicit TFutureState(FQueuedThreadPool* InThreadPool)
+		: FFutureStateBase(InThreadPool)
+	{}
+
+	void EmplaceResult()
+	{
+		assert(!IsComplete() && "The result of a future can only be set once");
+		MarkComplete();
+	}
+
+	void GetResult() const
+	{}
+};
+
+/** Calls a continuation with the result of the future it follows. */
+template<typename ResultType>
+struct TFutureInvoke
+{
+	template<typename FunctionType>
+	static auto Invoke(FunctionType& Function, const TFutureState<ResultType>& State) -> decltype(Function(State.GetResult()))
+	{
+		return Function(State.GetResult());
+	}
+};
+
+template<>
+struct TFutureInvoke<void>
+{
+	template<typename FunctionType>
+	static auto Invoke(FunctionType& Function, const TFutureState<void>&) -> decltype(Function())
+	{
+		return Function();
+	}
+};
+
+/** Stores the return value of a callable into a state, handling callables returning void. */
+template<typename ResultType>
+struct TFutureSetResult
+{
+	template<typename CallableType>
+	static void Set(TFutureState<ResultType>& State, CallableType& Callable)
+	{
+		State.EmplaceResult(Callable());
+	}
+};
+
+template<>
+struct TFutureSetResult<void>
+{
+	template<typename CallableType>
+	static void Set(TFutureState<void>& State, CallableType& Callable)
+	{
+		Callable();
+		State.EmplaceResult();
+	}
+};
+
+template<typename ResultType> class TPromise;
+
+/**
+* Handle to a result that becomes available later.
+*
+* Futures are cheap to copy, all copies refer to the same result.
+*/
+template<typename ResultType>
+class TFuture
+{
+public:
+	TFuture()
+		: State(nullptr)
+	{}
+
+	explicit TFuture(TFutureState<ResultType>* InState)
+		: State(InState)
+	{
+		if (State)
+		{
+			State->AddRef();
+		}
+	}
+
+	TFuture(const TFuture& Other)
+		: TFuture(Other.State)
+	{}
+
+	TFuture(TFuture&& Other)
+		: State(Other.State)
+	{
+		Other.State = nullptr;
+	}
+
+	TFuture& operator=(TFuture Other)
+	{
+		std::swap(State, Other.State);
+		return *this;
+	}
+
+	~TFuture()
+	{
+		if (State)
+		{
+			State->Release();
+		}
+	}
+
+	/** @return true if this future refers to a result. */
+	bool IsValid() const
+	{
+		return State != nullptr;
+	}
+
+	/** @return true if the result is available, or the future completed with an error. */
+	bool IsReady() const
+	{
+		assert(State);
+		return State->IsComplete();
+	}
+
+	/** @return Why the complete future has no result, EFutureError::None if it has one or is not complete. */
+	EFutureError GetError() const
+	{
+		assert(State);
+		return State->GetError();
+	}
+
+	/** Waits for the result, executing pending pool work meanwhile. */
+	void Wait() const
+	{
+		assert(State);
+		State->Wait();
+	}
+
+	/**
+	* Waits for the result and returns it. The future must not complete with an error.
+	*
+	* @return The result, valid as long as a future refers to it.
+	*/
+	auto Get() const -> decltype(std::declval<const TFutureState<ResultType>&>().GetResult())
+	{
+		Wait();
+		assert(State->GetError() == EFutureError::None && "The future has no result, check GetError");
+		return State->GetResult();
+	}
+
+	/**
+	* Queues a function on the pool once the result is available.
+	*
+	* @param Continuation Called with the result (nothing for TFuture<void>)
+	* @return A future for the value the continuation returns. If this future completes with
+	*	an error, the continuation is not called and the returned future gets the same error.
+	*/
+	template<typename FunctionType>
+	auto Then(FunctionType&& Continuation) const
+		-> TFuture<decltype(TFutureInvoke<ResultType>::Invoke(std::declval<typename std::decay<FunctionType>::type&>(), std::declval<const TFutureState<ResultType>&>()))>;
+
+	/** @return The shared state, used by the combinators. */
+	TFutureState<ResultType>* GetState() const
+	{
+		return State;
+	}
+
+private:
+	TFutureState<ResultType>* State;
+};
+
+/**
+* Producer side of a TFuture, sets the result exactly once.
+*/
+template<typename ResultType>
+class TPromise
+{
+public:
+	/**
+	* @param InThreadPool The pool continuations of the future run on, GThreadPool if nullptr
+	*/
+	explicit TPromise(FQueuedThreadPool* InThreadPool = nullptr)
+		: State(new TFutureState<ResultType>(InThreadPool))
+	{
+		// The promise holds the reference the state was created with
+	}
+
+	TPromise(TPromise&& Other)
+		: State(Other.State)
+	{
+		Other.State = nullptr;
+	}
+
+	TPromise& operator=(TPromise&& Other)
+	{
+		std::swap(State, Other.State);
+		return *this;
+	}
+
+	/** Completes the future with EFutureError::BrokenPromise if the result was never set. */
+	~TPromise()
+	{
+		if (State)
+		{
+			if (!State->IsComplete())
+			{
+				State->SetError(EFutureError::BrokenPromise);
+			}
+			State->Release();
+		}
+	}
+
+	/** @return A future for the result of this promise. */
+	TFuture<ResultType> GetFuture() const
+	{
+		return TFuture<ResultType>(State);
+	}
+
+	/**
+	* Sets the result, releasing waiters and starting continuations.
+	*
+	* @param Args Arguments the result is constructed from, none for TPromise<void>
+	*/
+	template<typename... ArgTypes>
+	void SetValue(ArgTypes&&... Args)
+	{
+		assert(State);
+		State->EmplaceResult(std::forward<ArgTypes>(Args)...);
+	}
+
+	/**
+	* Completes the future without a result, releasing waiters and continuations.
+	*
+	* @param Error Why there is no result
+	*/
+	void SetError(EFutureError Error)
+	{
+		assert(State);
+		State->SetError(Error);
+	}
+
+	/** @return The shared state. */
+	TFutureState<ResultType>* GetState() const
+	{
+		return State;
+	}
+
+private:
+	TFutureState<ResultType>* State;
+
+	TPromise(const TPromise&);
+	TPromise& operator=(const TPromise&);
+};
+
+/**
+* Queued work completing a promise. Deletes itself once run, an abandoned work does not
+* run but completes the future with an error, so nothing waits for it forever.
+*/
+class FPromiseWorkBase : public IQueuedWork
+{
+public:
+	/**
+	* @param InState The state the work completes, a waiter on it may execute the work itself
+	*/
+	explicit FPromiseWorkBase(FFutureStateBase* InState)
+		: State(InState)
+	{
+		State->SetProducerWork(this);
+	}
+
+	/**
+	* Completes the promise with an error without running, and deletes the work.
+	*
+	* @param Error Why the work did not run
+	*/
+	virtual void Break(EFutureError Error) = 0;
+
+	virtual void Abandon() override
+	{
+		// Called by a pool shutting down, which the callable might use again
+		Break(EFutureError::Abandoned);
+	}
+
+protected:
+	/** Called first when the work runs or breaks, waiters cannot take it anymore. */
+	void Start()
+	{
+		State->SetProducerWork(nullptr);
+	}
+
+private:
+	FFutureStateBase* State;
+};
+
+/**
+* Work that calls a function and sets the result of a promise with its return value.
+*/
+template<typename ResultType, typename CallableType>
+class TPromiseWork final : public FPromiseWorkBase
+{
+public:
+	TPromiseWork(CallableType&& InCallable, TPromise<ResultType>&& InPromise)
+		: FPromiseWorkBase(InPromise.GetState())
+		, Callable(std::move(InCallable))
+		, Promise(std::move(InPromise))
+	{}
+
+	virtual void DoThreadedWork() override
+	{
+		Start();
+		TFutureSetResult<ResultType>::Set(*Promise.GetState(), Callable);
+		delete this;
+	}
+
+	virtual void Break(EFutureError Error) override
+	{
+		Start();
+		Promise.SetError(Error);
+		delete this;
+	}
+
+private:
+	CallableType			Callable;
+	TPromise<ResultType>	Promise;
+};
+
+/**
+* Work that calls a continuation with the result of the future it follows and sets the
+* result of a promise with its return value. An error of the future carries over instead.
+*/
+template<typename AntecedentType, typename ResultType, typename FunctionType>
+class TContinuationWork final : public FPromiseWorkBase
+{
+public:
+	TContinuationWork(const TFuture<AntecedentType>& InAntecedent, FunctionType&& InFunction, TPromise<ResultType>&& InPromise)
+		: FPromiseWorkBase(InPromise.GetState())
+		, Antecedent(InAntecedent)
+		, Function(std::move(InFunction))
+		, Promise(std::move(InPromise))
+	{}
+
+	virtual void DoThreadedWork() override
+	{
+		Start();
+		const EFutureError AntecedentError = Antecedent.GetError();
+		if (AntecedentError != EFutureError::None)
+		{
+			Promise.SetError(AntecedentError);
+		}
+		else
+		{
+			auto Callable = [this]()
+			{
+				return TFutureInvoke<AntecedentType>::Invoke(Function, *Antecedent.GetState());
+			};
+			TFutureSetResult<ResultType>::Set(*Promise.GetState(), Callable);
+		}
+		delete this;
+	}
+
+	virtual void Break(EFutureError Error) override
+	{
+		Start();
+		Promise.SetError(Error);
+		delete this;
+	}
+
+private:
+	/** Keeps the antecedent alive until the continuation ran. */
+	TFuture<AntecedentType>	Antecedent;
+	FunctionType			Function;
+	TPromise<ResultType>	Promise;
+};
+
+template<typename ResultType>
+template<typename FunctionType>
+auto TFuture<ResultType>::Then(FunctionType&& Continuation) const
+	-> TFuture<decltype(TFutureInvoke<ResultType>::Invoke(std::declval<typename std::decay<FunctionType>::type&>(), std::declval<const TFutureState<ResultType>&>()))>
+{
+	typedef typename std::decay<FunctionType>::type FFunction;
+	typedef decltype(TFutureInvoke<ResultType>::Invoke(std::declval<FFunction&>(), std::declval<const TFutureState<ResultType>&>())) FContinuationResult;
+	assert(State);
+
+	TPromise<FContinuationResult> Promise(State->GetThreadPool());
+	TFuture<FContinuationResult> Future = Promise.GetFuture();
+	State->AddContinuation(new TContinuationWork<ResultType, FContinuationResult, FFunction>(*this, FFunction(std::forward<FunctionType>(Continuation)), std::move(Promise)));
+	return Future;
+}
+
+/**
+* Queues a function on a pool, subject to the pool's queue capacity and overflow policy.
+*
+* @param Function The function to call
+* @param ThreadPool The pool to run it on, GThreadPool if nullptr
+* @return A future for the value the function returns, complete with EFutureError::Rejected
+*	right away if the queue refused the function.
+*/
+template<typename FunctionType>
+auto Async(FunctionType&& Function, FQueuedThreadPool* ThreadPool = nullptr) -> TFuture<decltype(Function())>
+{
+	typedef decltype(Function()) FResult;
+	typedef typename std::decay<FunctionType>::type FFunction;
+	TPromise<FResult> Promise(ThreadPool);
+	TFuture<FResult> Future = Promise.GetFuture();
+	FQueuedThreadPool* Pool = Promise.GetState()->GetThreadPool();
+	FPromiseWorkBase* Work = new TPromiseWork<FResult, FFunction>(FFunction(std::forward<FunctionType>(Function)), std::move(Promise));
+	if (Pool->QueuedThreadWork(Work) == EQueuedWorkResult::Rejected)
+	{
+		// Still ours, it completes the future so that nothing waits for it forever
+		Work->Break(EFutureError::Rejected);
+	}
+	return Future;
+}
+
+/**
+* Combines futures into one that is ready once all of them are.
+*
+* @param States The shared states of the futures
+* @return A future ready when all are, complete with the error of the first one
+*	completing with an error if any does.
+*/
+TFuture<void> WhenAll(const std::vector<FFutureStateBase*>& States);
+
+/**
+* Combines futures into one that is ready once any of them is.
+*
+* @param States The shared states of the futures
+* @return A future for the index of the first one ready, INDEX_NONE if there were none.
+*/
+TFuture<int32> WhenAny(const std::vector<FFutureStateBase*>& States);
+
+template<typename ResultType>
+TFuture<void> WhenAll(const std::vector<TFuture<ResultType>>& Futures)
+{
+	std::vector<FFutureStateBase*> States;
+	States.reserve(Futures.size());
+	for (const TFuture<ResultType>& Future : Futures)
+	{
+		States.push_back(Future.GetState());
+	}
+	return WhenAll(States);
+}
+
+template<typename ResultType>
+TFuture<int32> WhenAny(const std::vector<TFuture<ResultType>>& Futures)
+{
+	std::vector<FFutureStateBase*> States;
+	States.reserve(Futures.size());
+	for (const TFuture<ResultType>& Future : Futures)
+	{
+		States.push_back(Future.GetState());
+	}
+	return WhenAny(States);
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <functional>
+
+/**
+* Interface for queued work objects.
+*
+* This interface is a type of runnable object that requires no per thread
+* initialization. It is meant to be used with pools of threads in an
+* abstract way that prevents the pool from needing to know any details
+* about the object being run. This allows queuing of disparate tasks and
+* servicing those tasks with a generic thread pool.
+*/
+class IQueuedWork
+{
+public:
+	/**
+	* This is where the real thread work is done. All work that is done for
+	* this queued object should be done from within the call to this function.
+	*/
+	virtual void DoThreadedWork() = 0;
+
+	/**
+	* Tells the queued work that it is being abandoned so that it can do
+	* per object clean up as needed. This will only be called if it is being
+	* abandoned before completion. NOTE: This requires the object to delete
+	* itself using whatever heap it was allocated in.
+	*/
+	virtual void Abandon() = 0;
+
+	/**
+	* Whether EQueueOverflowPolicy::DropOldest may abandon this work to make room.
+	* Works standing in for others, such as a pipe or a task group ticket, return false.
+	*/
+	virtual bool CanBeDropped() const
+	{
+		return true;
+	}
+
+public:
+	/** Virtual destructor so that child implementations are guaranteed a chance to clean up any resources they allocated. */
+	virtual ~IQueuedWork() {}
+};
+
+/**
+* Queued work that wraps a callable and deletes itself once it was run or abandoned.
+*/
+class FFunctionQueuedWork final : public IQueuedWork
+{
+public:
+	explicit FFunctionQueuedWork(std::function<void()> InFunction)
+		: Function(std::move(InFunction))
+	{}
+
+	virtual void DoThreadedWork() override
+	{
+		Function();
+		delete this;
+	}
+
+	virtual void Abandon() override
+	{
+		delete this;
+	}
+
+private:
+	std::function<void()> Function;
+};
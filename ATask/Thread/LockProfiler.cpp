@@ -0,0 +1,251 @@
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include "LockProfiler.h"
+
+/////////////////////////////////////*Lock Stats*/////////////////////////////////////
+FLockStats::FLockStats()
+	: Lock(nullptr)
+	, AcquireCount(0)
+	, ContendedCount(0)
+	, TotalWaitCycles(0)
+	, TotalHoldCycles(0)
+{
+	for (int32 Bucket = 0; Bucket < NumBuckets; ++Bucket)
+	{
+		WaitHistogram[Bucket].store(0, std::memory_order_relaxed);
+		HoldHistogram[Bucket].store(0, std::memory_order_relaxed);
+	}
+}
+
+void FLockStats::AddToHistogram(std::atomic<uint64>* Histogram, uint64 Cycles)
+{
+	int32 Bucket = 0;
+	while (Cycles > 1 && Bucket < NumBuckets - 1)
+	{
+		Cycles >>= 1;
+		++Bucket;
+	}
+	Histogram[Bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+FLockSiteStats::FLockSiteStats(const char* InLockName, const char* InFile, int32 InLine)
+	: LockName(InLockName)
+	, File(InFile)
+	, Line(InLine)
+{
+	FLockProfiler::Get().AddSite(this);
+}
+
+FLockStats& FLockSiteStats::FindOrAddLock(const FCriticalSection* InLock)
+{
+	for (int32 Index = 0; Index < MaxLocksPerSite; ++Index)
+	{
+		const FCriticalSection* EntryLock = Locks[Index].Lock.load(std::memory_order_acquire);
+		if (EntryLock == InLock)
+		{
+			return Locks[Index];
+		}
+		if (EntryLock == nullptr)
+		{
+			const FCriticalSection* Expected = nullptr;
+			if (Locks[Index].Lock.compare_exchange_strong(Expected, InLock) || Expected == InLock)
+			{
+				return Locks[Index];
+			}
+		}
+	}
+	return Locks[MaxLocksPerSite];
+}
+
+/////////////////////////////////////*Profiled Scope Lock*/////////////////////////////////////
+FProfiledScopeLock::FProfiledScopeLock(FCriticalSection* InSyncObject, FLockSiteStats& InSite)
+	: SyncObject(InSyncObject)
+	, Stats(&InSite.FindOrAddLock(InSyncObject))
+{
+	assert(SyncObject);
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	if (!SyncObject->TryLock())
+	{
+		SyncObject->Lock();
+		Stats->ContendedCount.fetch_add(1, std::memory_order_relaxed);
+	}
+	AcquiredCycles = FPlatformTime::Cycles64();
+
+	const uint64 WaitCycles = AcquiredCycles - StartCycles;
+	Stats->AcquireCount.fetch_add(1, std::memory_order_relaxed);
+	Stats->TotalWaitCycles.fetch_add(WaitCycles, std::memory_order_relaxed);
+	FLockStats::AddToHistogram(Stats->WaitHistogram, WaitCycles);
+}
+
+FProfiledScopeLock::~FProfiledScopeLock()
+{
+	const uint64 HoldCycles = FPlatformTime::Cycles64() - AcquiredCycles;
+	SyncObject->UnLock();
+
+	Stats->TotalHoldCycles.fetch_add(HoldCycles, std::memory_order_relaxed);
+	FLockStats::AddToHistogram(Stats->HoldHistogram, HoldCycles);
+}
+
+/////////////////////////////////////*Lock Profiler*/////////////////////////////////////
+namespace LockProfilerImpl
+{
+	/** Plain copy of FLockStats used to aggregate and sort at dump time. */
+	struct FStatsSnapshot
+	{
+		std::string Label;
+		uint64 AcquireCount = 0;
+		uint64 ContendedCount = 0;
+		uint64 TotalWaitCycles = 0;
+		uint64 TotalHoldCycles = 0;
+		uint64 WaitHistogram[FLockStats::NumBuckets] = {};
+		uint64 HoldHistogram[FLockStats::NumBuckets] = {};
+
+		void Add(const FLockStats& Stats)
+		{
+			AcquireCount += Stats.AcquireCount.load(std::memory_order_relaxed);
+			ContendedCount += Stats.ContendedCount.load(std::memory_order_relaxed);
+			TotalWaitCycles += Stats.TotalWaitCycles.load(std::memory_order_relaxed);
+			TotalHoldCycles += Stats.TotalHoldCycles.load(std::memory_order_relaxed);
+			for (int32 Bucket = 0; Bucket < FLockStats::NumBuckets; ++Bucket)
+			{
+				WaitHistogram[Bucket] += Stats.WaitHistogram[Bucket].load(std::memory_order_relaxed);
+				HoldHistogram[Bucket] += Stats.HoldHistogram[Bucket].load(std::memory_order_relaxed);
+			}
+		}
+	};
+
+	void DumpHistogram(std::ostream& Output, const char* Name, const uint64* Histogram)
+	{
+		const double MicroSecondsPerCycle = FPlatformTime::GetSecondsPerCycle64() * 1000000.0;
+		Output << "    " << Name << ":";
+		for (int32 Bucket = 0; Bucket < FLockStats::NumBuckets; ++Bucket)
+		{
+			if (Histogram[Bucket] != 0)
+			{
+				Output << " [<" << (double)(2ull << Bucket) * MicroSecondsPerCycle << "us]=" << Histogram[Bucket];
+			}
+		}
+		Output << "\n";
+	}
+
+	void DumpSnapshots(std::ostream& Output, std::vector<FStatsSnapshot>& Snapshots)
+	{
+		const double MicroSecondsPerCycle = FPlatformTime::GetSecondsPerCycle64() * 1000000.0;
+		std::sort(Snapshots.begin(), Snapshots.end(), [](const FStatsSnapshot& A, const FStatsSnapshot& B)
+		{
+			return A.TotalWaitCycles > B.TotalWaitCycles;
+		});
+		for (const FStatsSnapshot& Snapshot : Snapshots)
+		{
+			if (Snapshot.AcquireCount == 0)
+			{
+				continue;
+			}
+			Output << "  " << Snapshot.Label
+				<< " acquires=" << Snapshot.AcquireCount
+				<< " contended=" << Snapshot.ContendedCount
+				<< " (" << std::fixed << std::setprecision(1) << 100.0 * Snapshot.ContendedCount / Snapshot.AcquireCount << "%)"
+				<< std::setprecision(3)
+				<< " wait=" << Snapshot.TotalWaitCycles * MicroSecondsPerCycle << "us"
+				<< " hold=" << Snapshot.TotalHoldCycles * MicroSecondsPerCycle << "us\n";
+			DumpHistogram(Output, "wait", Snapshot.WaitHistogram);
+			DumpHistogram(Output, "hold", Snapshot.HoldHistogram);
+		}
+	}
+}
+
+void FLockProfiler::AddSite(FLockSiteStats* Site)
+{
+	FScopeLock SitesLock(&SitesCritical);
+	Sites.push_back(Site);
+}
+
+void FLockProfiler::Dump(std::ostream& Output)
+{
+	using namespace LockProfilerImpl;
+#if !LOCK_PROFILING
+	Output << "Lock profiling is disabled, build with LOCK_PROFILING=1\n";
+#endif
+	std::vector<FStatsSnapshot> SiteSnapshots;
+	std::map<const FCriticalSection*, FStatsSnapshot> LockSnapshots;
+	{
+		FScopeLock SitesLock(&SitesCritical);
+		for (FLockSiteStats* Site : Sites)
+		{
+			for (int32 Index = 0; Index <= FLockSiteStats::MaxLocksPerSite; ++Index)
+			{
+				const FLockStats& Stats = Site->Locks[Index];
+				const FCriticalSection* Lock = Stats.Lock.load();
+				if (Lock == nullptr && Index != FLockSiteStats::MaxLocksPerSite)
+				{
+					continue;
+				}
+
+				std::ostringstream Label;
+				Label << Site->File << ":" << Site->Line << " " << Site->LockName << " (";
+				if (Lock != nullptr)
+				{
+					Label << Lock;
+				}
+				else
+				{
+					Label << "other locks";
+				}
+				Label << ")";
+				SiteSnapshots.push_back(FStatsSnapshot());
+				SiteSnapshots.back().Label = Label.str();
+				SiteSnapshots.back().Add(Stats);
+
+				if (Lock != nullptr)
+				{
+					FStatsSnapshot& LockSnapshot = LockSnapshots[Lock];
+					if (LockSnapshot.Label.empty())
+					{
+						std::ostringstream LockLabel;
+						LockLabel << Site->LockName << " (" << Lock << ")";
+						LockSnapshot.Label = LockLabel.str();
+					}
+					LockSnapshot.Add(Stats);
+				}
+			}
+		}
+	}
+
+	std::vector<FStatsSnapshot> PerLock;
+	for (auto& LockPair : LockSnapshots)
+	{
+		PerLock.push_back(LockPair.second);
+	}
+	Output << "Lock contention per lock:\n";
+	DumpSnapshots(Output, PerLock);
+	Output << "Lock contention per site:\n";
+	DumpSnapshots(Output, SiteSnapshots);
+}
+
+void FLockProfiler::Reset()
+{
+	FScopeLock SitesLock(&SitesCritical);
+	for (FLockSiteStats* Site : Sites)
+	{
+		for (FLockStats& Stats : Site->Locks)
+		{
+			Stats.AcquireCount.store(0, std::memory_order_relaxed);
+			Stats.ContendedCount.store(0, std::memory_order_relaxed);
+			Stats.TotalWaitCycles.store(0, std::memory_order_relaxed);
+			Stats.TotalHoldCycles.store(0, std::memory_order_relaxed);
+			for (int32 Bucket = 0; Bucket < FLockStats::NumBuckets; ++Bucket)
+			{
+				Stats.WaitHistogram[Bucket].store(0, std::memory_order_relaxed);
+				Stats.HoldHistogram[Bucket].store(0, std::memory_order_relaxed);
+			}
+		}
+	}
+}
+
+FLockProfiler& FLockProfiler::Get()
+{
+	static FLockProfiler Singleton;
+	return Singleton;
+}
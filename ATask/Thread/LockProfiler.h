@@ -0,0 +1,127 @@
+#pragma once
+#include <atomic>
+#include <ostream>
+#include <vector>
+#include "../HAL/HAL.h"
+#include "FScopeLock.h"
+
+/**
+* Lock contention profiling.
+*
+* Build with LOCK_PROFILING=1 to record, for every SCOPE_LOCK site and every
+* lock used at that site, how often the lock was acquired, how often the
+* acquisition had to wait, and histograms of the wait and hold times.
+* With LOCK_PROFILING=0 (the default) SCOPE_LOCK is a plain FScopeLock.
+*/
+#ifndef LOCK_PROFILING
+#define LOCK_PROFILING 0
+#endif
+
+#define LOCK_PROFILING_JOIN_INNER(A, B) A##B
+#define LOCK_PROFILING_JOIN(A, B) LOCK_PROFILING_JOIN_INNER(A, B)
+
+#if LOCK_PROFILING
+/**
+* Locks a FCriticalSection* for the rest of the scope and records the acquisition at this file:line.
+*/
+#define SCOPE_LOCK(SyncObject) SCOPE_LOCK_INNER(SyncObject, LOCK_PROFILING_JOIN(__LINE__, LOCK_PROFILING_JOIN(_, __COUNTER__)))
+#define SCOPE_LOCK_INNER(SyncObject, Id) \
+	static FLockSiteStats LOCK_PROFILING_JOIN(LockSite_, Id)(#SyncObject, __FILE__, __LINE__); \
+	FProfiledScopeLock LOCK_PROFILING_JOIN(ScopeLock_, Id)(SyncObject, LOCK_PROFILING_JOIN(LockSite_, Id))
+#else
+#define SCOPE_LOCK(SyncObject) \
+	FScopeLock LOCK_PROFILING_JOIN(ScopeLock_, LOCK_PROFILING_JOIN(__LINE__, LOCK_PROFILING_JOIN(_, __COUNTER__)))(SyncObject)
+#endif
+
+/** Statistics of one lock acquired at one site. */
+struct FLockStats
+{
+	/** Histogram buckets, bucket N counts durations of [2^N, 2^(N+1)) FPlatformTime cycles. */
+	static const int32 NumBuckets = 40;
+
+	FLockStats();
+
+	/** The lock these statistics are for, nullptr for an unused entry. */
+	std::atomic<const FCriticalSection*> Lock;
+
+	std::atomic<uint64> AcquireCount;
+	std::atomic<uint64> ContendedCount;
+	std::atomic<uint64> TotalWaitCycles;
+	std::atomic<uint64> TotalHoldCycles;
+	std::atomic<uint64> WaitHistogram[NumBuckets];
+	std::atomic<uint64> HoldHistogram[NumBuckets];
+
+	/** Records a duration into a histogram. */
+	static void AddToHistogram(std::atomic<uint64>* Histogram, uint64 Cycles);
+};
+
+/**
+* Statistics of one SCOPE_LOCK site, created once as a function local static.
+*/
+class FLockSiteStats
+{
+public:
+	/** Locks tracked separately per site, further locks share the overflow entry. */
+	static const int32 MaxLocksPerSite = 8;
+
+	FLockSiteStats(const char* InLockName, const char* InFile, int32 InLine);
+
+	/** @return The entry recording the given lock at this site. */
+	FLockStats& FindOrAddLock(const FCriticalSection* InLock);
+
+	const char*		LockName;
+	const char*		File;
+	int32			Line;
+
+	/** One entry per lock, the last one collects every lock that did not fit. */
+	FLockStats		Locks[MaxLocksPerSite + 1];
+};
+
+/**
+* Scope lock recording its acquisition in a FLockSiteStats.
+*/
+class FProfiledScopeLock
+{
+public:
+	FProfiledScopeLock(FCriticalSection* InSyncObject, FLockSiteStats& InSite);
+	~FProfiledScopeLock();
+
+private:
+	FCriticalSection*	SyncObject;
+	FLockStats*			Stats;
+	uint64				AcquiredCycles;
+
+	FProfiledScopeLock(const FProfiledScopeLock&);
+	FProfiledScopeLock& operator=(const FProfiledScopeLock&);
+};
+
+/**
+* Registry of all lock sites, dumps the collected statistics.
+*/
+class FLockProfiler
+{
+public:
+	/** Used internally to register a site on first use. */
+	void AddSite(FLockSiteStats* Site);
+
+	/**
+	* Writes the statistics per lock and per site, most contended first.
+	*
+	* @param Output The stream to write to
+	*/
+	void Dump(std::ostream& Output);
+
+	/** Clears all collected statistics. */
+	void Reset();
+
+	/**
+	* Access to the singleton object.
+	*
+	* @return Lock profiler object.
+	*/
+	static FLockProfiler& Get();
+
+private:
+	std::vector<FLockSiteStats*>	Sites;
+	FCriticalSection				SitesCritical;
+};
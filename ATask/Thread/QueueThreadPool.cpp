@@ -1,74 +1,696 @@
+#include <atomic>
+#include <deque>
+#include <iterator>
 #include <queue>
 #include <vector>
 #include "../HAL/HAL.h"
+#include "../HAL/Event.h"
 #include "Runnable.h"
+#include "RunnableThread.h"
+#include "SingleThreadRunnable.h"
+#include "LockProfiler.h"
+#include "IQueuedWork.h"
 #include "QueuedThreadPool.h"
+#include "ThreadManager.h"
 
 
-class IQueuedWork;
-class FQueuedThread;
+/** TLS slot holding the pool the current thread belongs to, so that a blocking producer can tell it would wait for itself. */
+static uint32 GCurrentThreadPoolTlsSlot = FPlatformTLS::AllocTlsSlot();
 
+/////////////////////////////////////QueuedThread/////////////////////////////////////
+/**
+* This is the interface used for all poolable threads. The usage pattern for
+* a poolable thread is different from a regular thread and this interface
+* reflects that. Queued threads spend most of their life cycle idle, waiting
+* for work to do. When signaled they perform a job and then return themselves
+* to their owning pool via a callback and go back to an idle state.
+*/
+class FQueuedThread : public FRunnable, public FSingleThreadRunnable
+{
+public:
+	FQueuedThread()
+		: DoWorkEvent(nullptr)
+		, TimeToDie(false)
+		, QueuedWork(nullptr)
+		, OwningThreadPool(nullptr)
+		, Thread(nullptr)
+	{}
+
+	/**
+	* Creates the thread with the specified stack size and creates the various
+	* events to be able to communicate with it.
+	*
+	* @param InPool The thread pool interface used to place this thread back into the pool of available threads when its work is done
+	* @param InStackSize The size of the stack to create. 0 means use the current thread's stack size
+	* @param ThreadPriority priority of new thread
+	* @return True if the thread and all of its initialization was successful, false otherwise
+	*/
+	bool Create(FQueuedThreadPool* InPool, uint32 InStackSize = 0, EThreadPriority ThreadPriority = TPri_Normal)
+	{
+		OwningThreadPool = InPool;
+		DoWorkEvent = FPlatformProcess::CreateSynchEvent();
+		if (DoWorkEvent == nullptr)
+		{
+			return false;
+		}
+		Thread = FRunnableThread::Create(this, TEXT("PoolThread"), InStackSize, ThreadPriority, FPlatformAffinity::GetPoolThreadMask());
+		return Thread != nullptr;
+	}
+
+	/**
+	* Tells the thread to exit and waits until it has done so.
+	*
+	* @return True if the thread exited graceful, false otherwise
+	*/
+	bool KillThread()
+	{
+		bool bDidExitOK = true;
+		// Tell the thread it needs to die
+		TimeToDie = true;
+		// Trigger the thread so that it will come out of the wait state if
+		// it isn't actively doing work
+		if (DoWorkEvent != nullptr)
+		{
+			DoWorkEvent->Trigger();
+		}
+		if (Thread != nullptr)
+		{
+			// Wait for the thread to leave its loop before releasing it
+			Thread->WaitForCompletion();
+			delete Thread;
+			Thread = nullptr;
+		}
+		// Clean up the event
+		delete DoWorkEvent;
+		DoWorkEvent = nullptr;
+		return bDidExitOK;
+	}
+
+	/**
+	* Tells the thread there is work to be done. Upon completion, the thread
+	* is responsible for adding itself back into the available pool.
+	*
+	* @param InQueuedWork The queued work to perform
+	*/
+	void DoWork(IQueuedWork* InQueuedWork)
+	{
+		assert(QueuedWork.load() == nullptr && "Can't do more than one task at a time");
+		// Tell the thread the work to be done
+		QueuedWork.store(InQueuedWork);
+		// Tell the thread to wake up and do its job
+		DoWorkEvent->Trigger();
+	}
+
+	virtual FSingleThreadRunnable* GetSingleThreadInterface() override
+	{
+		return this;
+	}
+
+protected:
+	/** Executes one work per tick when faked, the next one is fetched for the following tick. */
+	virtual bool Tick() override
+	{
+		IQueuedWork* LocalQueuedWork = QueuedWork.exchange(nullptr);
+		if (LocalQueuedWork == nullptr)
+		{
+			return false;
+		}
+		LocalQueuedWork->DoThreadedWork();
+		LocalQueuedWork = OwningThreadPool->ReturnToPoolOrGetNextJob(this);
+		if (LocalQueuedWork)
+		{
+			QueuedWork.store(LocalQueuedWork);
+		}
+		return true;
+	}
+
+	/** The thread loop, waits for work and returns itself to the pool when there is nothing left to do. */
+	virtual int Run() override
+	{
+		FPlatformTLS::SetTlsValue(GCurrentThreadPoolTlsSlot, OwningThreadPool);
+		while (!TimeToDie)
+		{
+			DoWorkEvent->Wait();
+			IQueuedWork* LocalQueuedWork = QueuedWork.exchange(nullptr);
+			while (LocalQueuedWork)
+			{
+				// Tell the object to do the work
+				LocalQueuedWork->DoThreadedWork();
+				// Let the object cleanup before we remove our ref to it
+				LocalQueuedWork = OwningThreadPool->ReturnToPoolOrGetNextJob(this);
+			}
+		}
+		// A cached OS thread goes on to run other runnables, which are not part of the pool
+		FPlatformTLS::SetTlsValue(GCurrentThreadPoolTlsSlot, nullptr);
+		return 0;
+	}
+
+	/** The event that tells the thread there is work to do. */
+	FEvent*						DoWorkEvent;
+
+	/** If true, the thread should exit. */
+	std::atomic<bool>			TimeToDie;
+
+	/** The work this thread is doing. */
+	std::atomic<IQueuedWork*>	QueuedWork;
+
+	/** The pool this thread belongs to. */
+	FQueuedThreadPool*			OwningThreadPool;
+
+	/** My Thread  */
+	FRunnableThread*			Thread;
+};
+
+
+/////////////////////////////////////QueuedThreadPoolBase/////////////////////////////////////
 class FQueuedThreadPoolBase : public FQueuedThreadPool
 {
 public:
-	FQueuedThreadPoolBase() : SyncQueue(nullptr), TimeToDie(false){}
+	FQueuedThreadPoolBase()
+		: SyncQueue(nullptr)
+		, SpaceAvailableEvent(nullptr)
+		, TimeToDie(false)
+		, NumWaitingProducers(0)
+		, NumBlockedPoolThreads(0)
+		, QueueCapacity(0)
+		, OverflowPolicy(EQueueOverflowPolicy::Block)
+	{
+		ResetQueueStats();
+	}
 	virtual ~FQueuedThreadPoolBase() { Destory(); }
 
 public:
 	virtual bool Create(uint32_t InNumQueuedThreads, uint32_t StackSize = (32 * 1024), EThreadPriority ThreadPriority = TPri_Normal) override;
 	virtual void Destory() override;
-	virtual void QueuedThreadWork(IQueuedWork* InQueuedWork) override;
+	virtual EQueuedWorkResult QueuedThreadWork(IQueuedWork* InQueuedWork, bool bBypassCapacity = false) override;
 	virtual bool RetractQueuedWork(IQueuedWork* InQueuedWork) override;
 	virtual IQueuedWork* ReturnToPoolOrGetNextJob(class FQueuedThread* InQueuedThread) override;
 	virtual int32_t GetNumThreads() const override
 	{
 		return AllThreads.size();
 	}
+	virtual bool TryExecuteQueuedWork() override;
+	virtual void AddBlockedWaiter(FEvent* WakeEvent, bool bCanHelp) override;
+	virtual void RemoveBlockedWaiter(FEvent* WakeEvent, bool bLeaving) override;
+	virtual bool IsStarved() const override;
+	virtual void SetQueueCapacity(uint32_t InCapacity, EQueueOverflowPolicy InPolicy) override;
+	virtual FQueuedThreadPoolStats GetQueueStats() const override;
+	virtual void ResetQueueStats() override;
 
 protected:
-	std::queue<IQueuedWork*>		QueuedWorks;
+	/** A queued work and when it was queued. */
+	struct FQueuedWorkEntry
+	{
+		IQueuedWork*	Work;
+		uint64			QueuedCycles;
+
+		/** Whether the work went through admission control and may be dropped. */
+		bool			bAdmitted;
+	};
+
+	/** A thread blocked in a helping wait. */
+	struct FBlockedWaiter
+	{
+		FEvent*			WakeEvent;
+		bool			bCanHelp;
+		bool			bPoolThread;
+	};
+
+	/** Pops the oldest work and records its queueing delay, SyncQueue must be locked. */
+	IQueuedWork* DequeueWork();
+
+	/** Wakes one blocked producer if it could get in now, SyncQueue must be locked. */
+	void WakeWaitingProducer();
+
+	/** Wakes one blocked waiter able to execute the queued work, SyncQueue must be locked. */
+	void WakeBlockedWaiter();
+
+	/** The work queue to pull from, a deque so that retracted work can be removed from the middle. */
+	std::deque<FQueuedWorkEntry>	QueuedWorks;
 	std::queue<FQueuedThread*>		QueuedThreads;
 	std::vector<FQueuedThread*>		AllThreads;
 
 	FCriticalSection*				SyncQueue;
-	bool							TimeToDie;
+
+	/** Triggered when work leaves the queue while producers are blocked, wakes one of them. */
+	FEvent*							SpaceAvailableEvent;
+	std::atomic<bool>				TimeToDie;
+
+	/** Producers blocked on a full queue, guarded by SyncQueue. */
+	uint32_t						NumWaitingProducers;
+
+	/** Threads blocked in helping waits, the latest last, guarded by SyncQueue. */
+	std::vector<FBlockedWaiter>		BlockedWaiters;
+
+	/** How many of the blocked waiters are pool threads, written under SyncQueue. */
+	std::atomic<uint32_t>			NumBlockedPoolThreads;
+
+	/** Maximum queue depth, 0 for unbounded. */
+	uint32_t						QueueCapacity;
+	EQueueOverflowPolicy			OverflowPolicy;
+
+	/** Gauges and counters, guarded by SyncQueue. */
+	FQueuedThreadPoolStats			Stats;
 };
 
 
 bool FQueuedThreadPoolBase::Create(uint32_t InNumQueuedThreads, uint32_t StackSize /* = (32 * 1024) */, EThreadPriority ThreadPriority /* = TPri_Normal */)
 {
+	// Make sure we have synch objects
+	bool bWasSuccessful = true;
+	assert(SyncQueue == nullptr);
+	SyncQueue = new FCriticalSection();
+	SpaceAvailableEvent = FPlatformProcess::CreateSynchEvent();
+	{
+		SCOPE_LOCK(SyncQueue);
+		// Presize the array so there is no extra memory allocation
+		AllThreads.reserve(InNumQueuedThreads);
 
+		// Now create each thread and add it to the array
+		for (uint32_t Count = 0; Count < InNumQueuedThreads && bWasSuccessful; Count++)
+		{
+			// Create a new queued thread
+			FQueuedThread* pThread = new FQueuedThread();
+			// Now create the thread and add it if ok
+			if (pThread->Create(this, OverrideStackSize ? OverrideStackSize : StackSize, ThreadPriority))
+			{
+				QueuedThreads.push(pThread);
+				AllThreads.push_back(pThread);
+			}
+			else
+			{
+				// Failed to fully create so clean up
+				bWasSuccessful = false;
+				delete pThread;
+			}
+		}
+	}
+	// Destroy any created threads if the full set was not successful
+	if (!bWasSuccessful)
+	{
+		Destory();
+	}
+	return bWasSuccessful;
 }
 
 void FQueuedThreadPoolBase::Destory()
 {
-
+	if (SyncQueue == nullptr)
+	{
+		return;
+	}
+	std::deque<FQueuedWorkEntry> AbandonedWorks;
+	{
+		SCOPE_LOCK(SyncQueue);
+		TimeToDie = true;
+		AbandonedWorks.swap(QueuedWorks);
+		// Blocked producers abandon their work, each wakes the next
+		WakeWaitingProducer();
+	}
+	// Clean up all queued objects outside of the lock, abandoning may complete futures
+	// whose continuations come back to the pool
+	for (FQueuedWorkEntry& Entry : AbandonedWorks)
+	{
+		Entry.Work->Abandon();
+	}
+	// Wait for all threads to finish up
+	while (true)
+	{
+		{
+			SCOPE_LOCK(SyncQueue);
+			if (AllThreads.size() == QueuedThreads.size() && NumWaitingProducers == 0)
+			{
+				break;
+			}
+		}
+		// Fake threads only finish the work handed to them when ticked
+		if (!FThreadManager::Get().Tick())
+		{
+			FPlatformProcess::Sleep(0.0f);
+		}
+	}
+	// Delete all threads
+	{
+		SCOPE_LOCK(SyncQueue);
+		// Now tell each thread to die and delete those
+		for (FQueuedThread* Thread : AllThreads)
+		{
+			Thread->KillThread();
+			delete Thread;
+		}
+		QueuedThreads = std::queue<FQueuedThread*>();
+		AllThreads.clear();
+	}
+	delete SyncQueue;
+	SyncQueue = nullptr;
+	delete SpaceAvailableEvent;
+	SpaceAvailableEvent = nullptr;
 }
 
-void FQueuedThreadPoolBase::QueuedThreadWork(IQueuedWork* InQueuedWork)
+EQueuedWorkResult FQueuedThreadPoolBase::QueuedThreadWork(IQueuedWork* InQueuedWork, bool bBypassCapacity /*= false*/)
 {
+	assert(InQueuedWork != nullptr);
+	bool bBlocked = false;
+	bool bWaiting = false;
+	while (true)
+	{
+		if (TimeToDie)
+		{
+			InQueuedWork->Abandon();
+			return EQueuedWorkResult::Abandoned;
+		}
+		// Check to see if a thread is available. Make sure no other threads
+		// can manipulate the thread pool while we do this.
+		assert(SyncQueue);
+		EQueuedWorkResult Result = EQueuedWorkResult::Queued;
+		IQueuedWork* DroppedWork = nullptr;
+		{
+			SCOPE_LOCK(SyncQueue);
+			const bool bWoken = bWaiting;
+			if (bWaiting)
+			{
+				bWaiting = false;
+				--NumWaitingProducers;
+			}
+
+			if (TimeToDie)
+			{
+				// Checked again under the lock, nothing may be queued once Destory took the queue
+				Result = EQueuedWorkResult::Abandoned;
+			}
+			else if (!QueuedThreads.empty())
+			{
+				// We have a thread, so tell it to do the work
+				FQueuedThread* Thread = QueuedThreads.front();
+				QueuedThreads.pop();
+				Thread->DoWork(InQueuedWork);
+				++Stats.NumQueued;
+			}
+			else
+			{
+				if (!bBypassCapacity && QueueCapacity != 0 && QueuedWorks.size() >= QueueCapacity)
+				{
+					EQueueOverflowPolicy Policy = OverflowPolicy;
+					if (Policy == EQueueOverflowPolicy::Block && (FPlatformTLS::GetTlsValue(GCurrentThreadPoolTlsSlot) == this || FThreadManager::Get().HasFakeThreads()))
+					{
+						// A pool thread waiting for room would wait for itself, as would anyone while fake threads need ticking
+						Policy = EQueueOverflowPolicy::RunInline;
+					}
+
+					switch (Policy)
+					{
+					case EQueueOverflowPolicy::Reject:
+						++Stats.NumRejected;
+						Result = EQueuedWorkResult::Rejected;
+						break;
+
+					case EQueueOverflowPolicy::RunInline:
+						++Stats.NumExecutedInline;
+						Result = EQueuedWorkResult::ExecutedInline;
+						break;
+
+					case EQueueOverflowPolicy::Block:
+						if (!bBlocked)
+						{
+							bBlocked = true;
+							++Stats.NumBlocked;
+						}
+						bWaiting = true;
+						++NumWaitingProducers;
+						break;
+
+					case EQueueOverflowPolicy::DropOldest:
+						// Only work that went through admission control and stands for nothing else may be dropped
+						for (auto It = QueuedWorks.begin(); It != QueuedWorks.end(); ++It)
+						{
+							if (It->bAdmitted && It->Work->CanBeDropped())
+							{
+								DroppedWork = It->Work;
+								QueuedWorks.erase(It);
+								break;
+							}
+						}
+						if (DroppedWork == nullptr)
+						{
+							++Stats.NumRejected;
+							Result = EQueuedWorkResult::Rejected;
+						}
+						else
+						{
+							++Stats.NumDropped;
+						}
+						break;
+					}
+				}
+
+				if (Result == EQueuedWorkResult::Queued && !bWaiting)
+				{
+					// There were no threads available, queue the work to be done
+					// as soon as one does become available
+					FQueuedWorkEntry Entry;
+					Entry.Work = InQueuedWork;
+					Entry.QueuedCycles = FPlatformTime::Cycles64();
+					Entry.bAdmitted = !bBypassCapacity;
+					QueuedWorks.push_back(Entry);
+					++Stats.NumQueued;
+					if (QueuedWorks.size() > Stats.PeakQueueDepth)
+					{
+						Stats.PeakQueueDepth = (uint32)QueuedWorks.size();
+					}
+					// No thread is idle, a thread blocked in a wait can execute it meanwhile
+					WakeBlockedWaiter();
+				}
+			}
+
+			if (bWoken)
+			{
+				// One wake up may stand for several pops, pass it on while there is room
+				WakeWaitingProducer();
+			}
+		}
+
+		if (bWaiting)
+		{
+			// Until a worker pops a work, the capacity changes or the pool shuts down
+			SpaceAvailableEvent->Wait();
+			continue;
+		}
+		switch (Result)
+		{
+		case EQueuedWorkResult::Abandoned:
+			InQueuedWork->Abandon();
+			break;
 
+		case EQueuedWorkResult::ExecutedInline:
+			InQueuedWork->DoThreadedWork();
+			break;
+
+		default:
+			break;
+		}
+		// Outside of the lock, the dropped work may run code of its own
+		if (DroppedWork != nullptr)
+		{
+			DroppedWork->Abandon();
+		}
+		return Result;
+	}
 }
 
-bool FQueuedThreadPoolBase::RetractQueuedWork(IQueuedWork* InQueuedWork)
+void FQueuedThreadPoolBase::WakeWaitingProducer()
 {
+	if (NumWaitingProducers > 0 && (TimeToDie || OverflowPolicy != EQueueOverflowPolicy::Block || QueueCapacity == 0 || QueuedWorks.size() < QueueCapacity))
+	{
+		SpaceAvailableEvent->Trigger();
+	}
+}
 
+bool FQueuedThreadPoolBase::RetractQueuedWork(IQueuedWork* InQueuedWork)
+{
+	if (TimeToDie)
+	{
+		return false; // no special consideration for this, refuse the retraction and let shutdown proceed
+	}
+	assert(InQueuedWork != nullptr);
+	assert(SyncQueue);
+	SCOPE_LOCK(SyncQueue);
+	for (auto It = QueuedWorks.begin(); It != QueuedWorks.end(); ++It)
+	{
+		if (It->Work == InQueuedWork)
+		{
+			QueuedWorks.erase(It);
+			WakeWaitingProducer();
+			return true;
+		}
+	}
+	return false;
 }
 
 IQueuedWork* FQueuedThreadPoolBase::ReturnToPoolOrGetNextJob(class FQueuedThread* InQueuedThread)
 {
+	assert(InQueuedThread != nullptr);
+	IQueuedWork* Work = nullptr;
+	// Check to see if there is any work to be done
+	SCOPE_LOCK(SyncQueue);
+	if (TimeToDie)
+	{
+		assert(QueuedWorks.empty());  // we better not have anything if we are dying
+	}
+	if (!QueuedWorks.empty())
+	{
+		// Grab the oldest work in the queue. This is slower than
+		// getting the most recent but prevents work from being
+		// queued and never done
+		Work = DequeueWork();
+	}
+	if (Work == nullptr)
+	{
+		// There was no work to be done, so add the thread to the pool
+		QueuedThreads.push(InQueuedThread);
+	}
+	return Work;
+}
 
+bool FQueuedThreadPoolBase::TryExecuteQueuedWork()
+{
+	assert(SyncQueue);
+	IQueuedWork* Work = nullptr;
+	{
+		SCOPE_LOCK(SyncQueue);
+		if (TimeToDie || QueuedWorks.empty())
+		{
+			return false;
+		}
+		Work = DequeueWork();
+	}
+	Work->DoThreadedWork();
+	return true;
 }
 
-uint32_t FQueuedThreadPool::OverrideStackSize = 0;
-FQueuedThreadPool* FQueuedThreadPool::Allocate()
+void FQueuedThreadPoolBase::AddBlockedWaiter(FEvent* WakeEvent, bool bCanHelp)
 {
-	return new FQueuedThreadPoolBase;
+	assert(WakeEvent != nullptr);
+	assert(SyncQueue);
+	SCOPE_LOCK(SyncQueue);
+	FBlockedWaiter Waiter;
+	Waiter.WakeEvent = WakeEvent;
+	Waiter.bCanHelp = bCanHelp;
+	Waiter.bPoolThread = FPlatformTLS::GetTlsValue(GCurrentThreadPoolTlsSlot) == this;
+	BlockedWaiters.push_back(Waiter);
+	if (Waiter.bPoolThread)
+	{
+		NumBlockedPoolThreads.fetch_add(1, std::memory_order_relaxed);
+	}
+	// Work queued before it registered, or that nobody takes now that this thread blocks as well
+	if (!QueuedWorks.empty())
+	{
+		WakeBlockedWaiter();
+	}
+}
+
+void FQueuedThreadPoolBase::RemoveBlockedWaiter(FEvent* WakeEvent, bool bLeaving)
+{
+	assert(SyncQueue);
+	SCOPE_LOCK(SyncQueue);
+	// Waiters sharing an event are interchangeable, any entry of it will do
+	for (auto It = BlockedWaiters.rbegin(); It != BlockedWaiters.rend(); ++It)
+	{
+		if (It->WakeEvent == WakeEvent)
+		{
+			if (It->bPoolThread)
+			{
+				NumBlockedPoolThreads.fetch_sub(1, std::memory_order_relaxed);
+			}
+			BlockedWaiters.erase(std::next(It).base());
+			break;
+		}
+	}
+	if (bLeaving && !QueuedWorks.empty())
+	{
+		WakeBlockedWaiter();
+	}
 }
 
+bool FQueuedThreadPoolBase::IsStarved() const
+{
+	const uint32_t NumOtherThreads = (uint32_t)AllThreads.size() - (FPlatformTLS::GetTlsValue(GCurrentThreadPoolTlsSlot) == this ? 1 : 0);
+	return NumBlockedPoolThreads.load(std::memory_order_relaxed) >= NumOtherThreads;
+}
 
-/////////////////////////////////////QueuedThread/////////////////////////////////////
-class FQueuedThread : public FRunnable
+void FQueuedThreadPoolBase::WakeBlockedWaiter()
 {
-public:
-};
\ No newline at end of file
+	if (BlockedWaiters.empty())
+	{
+		return;
+	}
+	// Once every pool thread waits, any waiter has to execute the work however deep it is nested
+	const bool bStarved = NumBlockedPoolThreads.load(std::memory_order_relaxed) == AllThreads.size();
+	for (auto It = BlockedWaiters.rbegin(); It != BlockedWaiters.rend(); ++It)
+	{
+		if (It->bCanHelp || bStarved)
+		{
+			It->WakeEvent->Trigger();
+			return;
+		}
+	}
+}
+
+IQueuedWork* FQueuedThreadPoolBase::DequeueWork()
+{
+	const FQueuedWorkEntry Entry = QueuedWorks.front();
+	QueuedWorks.pop_front();
+	// Let a blocked producer in
+	WakeWaitingProducer();
+
+	const double QueueDelaySeconds = (double)(FPlatformTime::Cycles64() - Entry.QueuedCycles) * FPlatformTime::GetSecondsPerCycle64();
+	Stats.LastQueueDelaySeconds = QueueDelaySeconds;
+	// Exponential moving average, recent delays matter most for a gauge
+	Stats.AverageQueueDelaySeconds += (QueueDelaySeconds - Stats.AverageQueueDelaySeconds) * 0.05;
+	if (QueueDelaySeconds > Stats.MaxQueueDelaySeconds)
+	{
+		Stats.MaxQueueDelaySeconds = QueueDelaySeconds;
+	}
+	return Entry.Work;
+}
+
+void FQueuedThreadPoolBase::SetQueueCapacity(uint32_t InCapacity, EQueueOverflowPolicy InPolicy)
+{
+	assert(SyncQueue);
+	{
+		SCOPE_LOCK(SyncQueue);
+		QueueCapacity = InCapacity;
+		OverflowPolicy = InPolicy;
+		// The first producer let in wakes the next while there is room
+		WakeWaitingProducer();
+	}
+}
+
+FQueuedThreadPoolStats FQueuedThreadPoolBase::GetQueueStats() const
+{
+	assert(SyncQueue);
+	SCOPE_LOCK(SyncQueue);
+	FQueuedThreadPoolStats Result = Stats;
+	Result.QueueDepth = (uint32)QueuedWorks.size();
+	return Result;
+}
+
+void FQueuedThreadPoolBase::ResetQueueStats()
+{
+	FQueuedThreadPoolStats EmptyStats = {};
+	if (SyncQueue == nullptr)
+	{
+		Stats = EmptyStats;
+		return;
+	}
+	SCOPE_LOCK(SyncQueue);
+	EmptyStats.PeakQueueDepth = (uint32)QueuedWorks.size();
+	EmptyStats.AverageQueueDelaySeconds = Stats.AverageQueueDelaySeconds;
+	Stats = EmptyStats;
+}
+
+uint32_t FQueuedThreadPool::OverrideStackSize = 0;
+FQueuedThreadPool* GThreadPool = nullptr;
+FQueuedThreadPool* FQueuedThreadPool::Allocate()
+{
+	return new FQueuedThreadPoolBase;
+}
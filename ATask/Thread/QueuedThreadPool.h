@@ -2,8 +2,69 @@
 #include <stdint.h>
 #include "ThreadUtility.h"
 
+class FEvent;
 class IQueuedWork;
 
+/**
+* What QueuedThreadWork does with new work when the queue is at capacity.
+*/
+enum class EQueueOverflowPolicy
+{
+	/** Blocks the producer until a worker takes work out of the queue. A pool thread runs the work inline instead, it would wait for itself. */
+	Block,
+
+	/** Refuses the work, the caller keeps ownership of it. */
+	Reject,
+
+	/** Runs the work on the calling thread. */
+	RunInline,
+
+	/** Abandons the oldest queued work that went through admission and can be dropped to make room, else refuses the work. */
+	DropOldest
+};
+
+/**
+* Outcome of QueuedThreadWork.
+*/
+enum class EQueuedWorkResult
+{
+	/** The work was handed to a thread or queued. */
+	Queued,
+
+	/** The queue was full and the work was refused, it was not run nor abandoned. */
+	Rejected,
+
+	/** The queue was full and the work ran on the calling thread. */
+	ExecutedInline,
+
+	/** The pool is shutting down and the work was abandoned. */
+	Abandoned
+};
+
+/**
+* Queue gauges and counters of a pool, see FQueuedThreadPool::GetQueueStats.
+*/
+struct FQueuedThreadPoolStats
+{
+	/** Works currently waiting in the queue. */
+	uint32 QueueDepth;
+
+	/** Highest queue depth since the last reset. */
+	uint32 PeakQueueDepth;
+
+	/** Counters since the last reset. */
+	uint64 NumQueued;
+	uint64 NumRejected;
+	uint64 NumExecutedInline;
+	uint64 NumDropped;
+	uint64 NumBlocked;
+
+	/** Time works spent waiting in the queue, works handed straight to an idle thread are not counted. */
+	double LastQueueDelaySeconds;
+	double AverageQueueDelaySeconds;
+	double MaxQueueDelaySeconds;
+};
+
 /**
 * Interface for queued thread pools.
 *
@@ -19,11 +80,67 @@ public:
 public:
 	virtual bool			Create(uint32_t InNumQueuedThreads, uint32_t StackSize = (32 * 1024), EThreadPriority ThreadPriority = TPri_Normal) = 0;
 	virtual void			Destory() = 0;
-	virtual void			QueuedThreadWork(IQueuedWork* InQueuedWork) = 0;
+
+	/**
+	* Queues work for a pool thread, applying the overflow policy if the queue is at capacity.
+	*
+	* @param InQueuedWork The work to do
+	* @param bBypassCapacity Set only to queue again work that was admitted already, such as a pipe
+	*	rescheduling itself; it is always queued and never counts against the capacity.
+	* @return What happened to the work. Rejected work was neither run nor abandoned, the caller still owns it.
+	*/
+	virtual EQueuedWorkResult	QueuedThreadWork(IQueuedWork* InQueuedWork, bool bBypassCapacity = false) = 0;
+
 	virtual bool			RetractQueuedWork(IQueuedWork* InQueuedWork) = 0;
 	virtual IQueuedWork*	ReturnToPoolOrGetNextJob(class FQueuedThread* InQueuedThread) = 0;
 	virtual int32_t			GetNumThreads() const = 0;
 
+	/**
+	* Executes the oldest queued work on the calling thread, used by threads that wait for work to complete.
+	*
+	* @return true if work was executed, false if the queue was empty.
+	*/
+	virtual bool			TryExecuteQueuedWork() = 0;
+
+	/**
+	* Registers a thread about to block in a helping wait, see FHelpingWait. While it is registered,
+	* work queued that no idle pool thread takes triggers the event of a registered waiter able to
+	* execute it, so that waiters never have to poll for work.
+	*
+	* @param WakeEvent Triggered to wake the waiter, several waiters may share it
+	* @param bCanHelp Whether the waiter executes any queued work, otherwise it is only woken
+	*	once every pool thread blocks in a helping wait
+	*/
+	virtual void			AddBlockedWaiter(FEvent* WakeEvent, bool bCanHelp) = 0;
+
+	/**
+	* Unregisters a waiter registered with AddBlockedWaiter.
+	*
+	* @param bLeaving Whether the waiter is done waiting; if work is queued another waiter is woken
+	*	in its place, it may have taken the wake up meant for the work
+	*/
+	virtual void			RemoveBlockedWaiter(FEvent* WakeEvent, bool bLeaving) = 0;
+
+	/**
+	* @return true if every pool thread other than the calling one blocks in a helping wait,
+	*	queued work only runs if a waiter executes it then.
+	*/
+	virtual bool			IsStarved() const = 0;
+
+	/**
+	* Limits the number of works waiting in the queue.
+	*
+	* @param InCapacity Maximum queue depth, 0 for unbounded (the default)
+	* @param InPolicy What to do with new work when the queue is full
+	*/
+	virtual void			SetQueueCapacity(uint32_t InCapacity, EQueueOverflowPolicy InPolicy) = 0;
+
+	/** @return The current queue gauges and counters. */
+	virtual FQueuedThreadPoolStats GetQueueStats() const = 0;
+
+	/** Resets the counters and peaks of GetQueueStats. The peak starts again at the current queue depth, not at 0. */
+	virtual void			ResetQueueStats() = 0;
+
 
 	static FQueuedThreadPool* Allocate();
 
@@ -35,5 +152,9 @@ public:
 	static uint32_t OverrideStackSize;
 };
 
+/**
+* The pool used wherever no pool is passed, created by main at startup and destroyed before it returns.
+* Code running without main, such as tests, has to set it up itself before relying on it.
+*/
 extern FQueuedThreadPool* GThreadPool;
 
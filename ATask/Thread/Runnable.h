@@ -11,4 +11,12 @@ public:
 	virtual int			Run() = 0; // return exit code
 	virtual void		Stop() {}
 	virtual void		Exit() {}
+
+	/**
+	* Gets single thread interface pointer used for ticking this runnable when multithreading is disabled.
+	* If the interface is not implemented, this runnable cannot be started without multithreading support.
+	*
+	* @return Pointer to the single thread interface or nullptr if it is not implemented.
+	*/
+	virtual class FSingleThreadRunnable* GetSingleThreadInterface() { return nullptr; }
 };
\ No newline at end of file
@@ -11,6 +11,8 @@
 class FRunnableThread
 {
 	friend class FThreadManager;
+	friend class FThreadCache;
+	friend class FCachedRunnableThread;
 
 	/** Index of TLS slot for FRunnableThread pointer. */
 	static unsigned int RunnableTlsSlot;
@@ -127,6 +129,9 @@ protected:
 		uint32 InStackSize = 0,
 		EThreadPriority InThreadPri = TPri_Normal, uint64 InThreadAffinityMask = 0) = 0;
 	
+	/** Converts and stores the name given at creation. */
+	void SetThreadName(const TCHAR* InThreadName);
+
 	/** Stores this instance in the runnable thread TLS slot. */
 	void SetTls();
 
@@ -162,7 +167,17 @@ protected:
 	/** ID set during thread creation. */
 	uint32 ThreadID;
 
+	/** Whether the thread deletes itself once its runnable has exited. */
+	bool bAutoDeleteSelf;
+
+	/** Whether the thread deletes the runnable once it has exited. */
+	bool bAutoDeleteRunnable;
+
 private:
-	/** Used by the thread manager to tick threads in single-threaded mode */
-	virtual void Tick() {}
+	/**
+	* Used by the thread manager to tick threads in single-threaded mode
+	*
+	* @return true if the runnable did any work.
+	*/
+	virtual bool Tick() { return false; }
 };
\ No newline at end of file
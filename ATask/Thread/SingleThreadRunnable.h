@@ -0,0 +1,21 @@
+#pragma once
+
+/**
+* Interface for ticking runnables when there is no support for multithreading.
+*
+* A runnable returning it from FRunnable::GetSingleThreadInterface can run on a fake
+* thread, which FThreadManager::Tick ticks on the calling thread instead of running
+* the runnable's Run loop on an OS thread.
+*/
+class FSingleThreadRunnable
+{
+public:
+	virtual ~FSingleThreadRunnable() {}
+
+	/**
+	* Does a small slice of the work Run would do, so that ticking stays within its budget.
+	*
+	* @return true if any work was done, false if the runnable was idle.
+	*/
+	virtual bool Tick() = 0;
+};
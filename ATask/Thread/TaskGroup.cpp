@@ -0,0 +1,363 @@
+#include <cassert>
+#include <deque>
+#include "TaskGroup.h"
+#include "LockProfiler.h"
+#include "QueuedThreadPool.h"
+#include "ThreadManager.h"
+
+/** Holds the number of helping waits the thread is nested in. */
+static uint32 GHelpDepthTlsSlot = FPlatformTLS::AllocTlsSlot();
+
+/////////////////////////////////////Helping Wait/////////////////////////////////////
+int32 FHelpingWait::MaxHelpDepth = 8;
+int32 FHelpingWait::MaxCooperativeHelpDepth = 256;
+
+int32 FHelpingWait::GetHelpDepth()
+{
+	return (int32)(intptr_t)FPlatformTLS::GetTlsValue(GHelpDepthTlsSlot);
+}
+
+bool FHelpingWait::TryHelp(FQueuedThreadPool* ThreadPool)
+{
+	assert(ThreadPool);
+	// With fake threads nobody else would ever execute the work, only the stack bounds the depth then
+	const bool bCooperative = FThreadManager::Get().HasFakeThreads();
+	const int32 HelpDepth = GetHelpDepth();
+	if (bCooperative)
+	{
+		assert(HelpDepth < MaxCooperativeHelpDepth && "Helping waits nested too deep with fake threads, the wait can never complete");
+		if (HelpDepth >= MaxCooperativeHelpDepth)
+		{
+			return false;
+		}
+	}
+	else if (HelpDepth >= MaxHelpDepth && !ThreadPool->IsStarved())
+	{
+		return false;
+	}
+
+	FPlatformTLS::SetTlsValue(GHelpDepthTlsSlot, (void*)(intptr_t)(HelpDepth + 1));
+	bool bExecuted = ThreadPool->TryExecuteQueuedWork();
+	if (!bExecuted && bCooperative)
+	{
+		// Drive the fake threads, such as the I/O threads, the wait may depend on them
+		bExecuted = FThreadManager::Get().Tick();
+	}
+	FPlatformTLS::SetTlsValue(GHelpDepthTlsSlot, (void*)(intptr_t)HelpDepth);
+	return bExecuted;
+}
+
+FEvent* FHelpingWait::GetOrCreateEvent(std::atomic<FEvent*>& Event)
+{
+	FEvent* ExistingEvent = Event.load();
+	if (ExistingEvent == nullptr)
+	{
+		FEvent* NewEvent = FPlatformProcess::CreateSynchEvent(false);
+		if (Event.compare_exchange_strong(ExistingEvent, NewEvent))
+		{
+			ExistingEvent = NewEvent;
+		}
+		else
+		{
+			delete NewEvent;
+		}
+	}
+	return ExistingEvent;
+}
+
+FEvent* FHelpingWait::BeginBlocking(FQueuedThreadPool* ThreadPool, std::atomic<FEvent*>& Event)
+{
+	if (FThreadManager::Get().HasFakeThreads())
+	{
+		// Only ticking moves the wait on, which TryHelp does, nothing could wake a blocked thread
+		FPlatformProcess::Sleep(0.0f);
+		return nullptr;
+	}
+	FEvent* WaitEvent = GetOrCreateEvent(Event);
+	ThreadPool->AddBlockedWaiter(WaitEvent, GetHelpDepth() < MaxHelpDepth);
+	return WaitEvent;
+}
+
+/////////////////////////////////////Task Group/////////////////////////////////////
+/**
+* State of a task group, shared with its tickets.
+*/
+class FTaskGroup::FGroupState
+{
+public:
+	FGroupState()
+		: RefCount(1)
+		, NumPending(0)
+		, CompletionEvent(nullptr)
+	{}
+
+	~FGroupState()
+	{
+		assert(Works.empty());
+		delete CompletionEvent.load();
+	}
+
+	void AddRef()
+	{
+		RefCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void Release()
+	{
+		if (RefCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			delete this;
+		}
+	}
+
+	void Push(IQueuedWork* InQueuedWork)
+	{
+		SCOPE_LOCK(&Critical);
+		Works.push_back(InQueuedWork);
+	}
+
+	/** @return true if the work was still queued and is removed, false if it was executed already. */
+	bool Remove(IQueuedWork* InQueuedWork)
+	{
+		SCOPE_LOCK(&Critical);
+		for (auto It = Works.begin(); It != Works.end(); ++It)
+		{
+			if (*It == InQueuedWork)
+			{
+				Works.erase(It);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/**
+	* Executes one queued work of the group.
+	*
+	* @param bNewest Whether to take the newest work rather than the oldest
+	* @return false if there was none.
+	*/
+	bool ExecuteOne(bool bNewest)
+	{
+		IQueuedWork* Work = Pop(bNewest);
+		if (Work == nullptr)
+		{
+			return false;
+		}
+		Work->DoThreadedWork();
+		Done();
+		return true;
+	}
+
+	/** Abandons the oldest queued work of the group, if there is any. */
+	void AbandonOne()
+	{
+		IQueuedWork* Work = Pop(false);
+		if (Work != nullptr)
+		{
+			Work->Abandon();
+			Done();
+		}
+	}
+
+	void Add(int32 Count)
+	{
+		assert(Count > 0);
+		if (NumPending.fetch_add(Count, std::memory_order_acq_rel) == 0)
+		{
+			// Reused after it completed, waiters have to block again
+			SCOPE_LOCK(&Critical);
+			FEvent* Event = CompletionEvent.load();
+			if (Event != nullptr && !IsComplete())
+			{
+				Event->Reset();
+			}
+		}
+	}
+
+	void Done()
+	{
+		int32 Pending = NumPending.load(std::memory_order_relaxed);
+		while (Pending > 1)
+		{
+			if (NumPending.compare_exchange_weak(Pending, Pending - 1, std::memory_order_acq_rel))
+			{
+				return;
+			}
+		}
+
+		// The last item completes under the lock Wait takes before returning
+		SCOPE_LOCK(&Critical);
+		const int32 PrevPending = NumPending.fetch_sub(1, std::memory_order_acq_rel);
+		assert(PrevPending > 0);
+		if (PrevPending == 1)
+		{
+			FEvent* Event = CompletionEvent.load();
+			if (Event != nullptr)
+			{
+				Event->Trigger();
+			}
+		}
+	}
+
+	bool IsComplete() const
+	{
+		return NumPending.load(std::memory_order_acquire) == 0;
+	}
+
+	void Wait(FQueuedThreadPool* ThreadPool)
+	{
+		FHelpingWait::Wait(ThreadPool, CompletionEvent, [this]()
+		{
+			return IsComplete();
+		}, [this]()
+		{
+			return ExecuteOne(true);
+		});
+		// Done may still be triggering the event
+		SCOPE_LOCK(&Critical);
+	}
+
+private:
+	IQueuedWork* Pop(bool bNewest)
+	{
+		SCOPE_LOCK(&Critical);
+		if (Works.empty())
+		{
+			return nullptr;
+		}
+		IQueuedWork* Work = nullptr;
+		if (bNewest)
+		{
+			Work = Works.back();
+			Works.pop_back();
+		}
+		else
+		{
+			Work = Works.front();
+			Works.pop_front();
+		}
+		return Work;
+	}
+
+	std::atomic<int32>			RefCount;
+	std::atomic<int32>			NumPending;
+
+	/** Created by the first waiter that has to block, nullptr until then. */
+	std::atomic<FEvent*>		CompletionEvent;
+
+	/** Guards the works and is held while the last item completes, so a waiter cannot destroy the group under it. */
+	FCriticalSection			Critical;
+	std::deque<IQueuedWork*>	Works;
+};
+
+/**
+* Queued on the pool for every task of the group, executes the oldest one still queued.
+* Finds nothing if a waiter executed the tasks itself already.
+*/
+class FTaskGroup::FGroupTicket final : public IQueuedWork
+{
+public:
+	explicit FGroupTicket(FGroupState* InState)
+		: State(InState)
+	{
+		State->AddRef();
+	}
+
+	virtual void DoThreadedWork() override
+	{
+		State->ExecuteOne(false);
+		State->Release();
+		delete this;
+	}
+
+	virtual void Abandon() override
+	{
+		State->AbandonOne();
+		State->Release();
+		delete this;
+	}
+
+	/** The task it executes was accepted by Run already. */
+	virtual bool CanBeDropped() const override
+	{
+		return false;
+	}
+
+	/** Deletes a ticket the pool refused, without executing anything. */
+	void Discard()
+	{
+		State->Release();
+		delete this;
+	}
+
+private:
+	FGroupState* State;
+};
+
+FTaskGroup::FTaskGroup(FQueuedThreadPool* InThreadPool /*= nullptr*/)
+	: ThreadPool(InThreadPool ? InThreadPool : GThreadPool)
+	, State(new FGroupState())
+{
+	assert(ThreadPool);
+}
+
+FTaskGroup::~FTaskGroup()
+{
+	Wait();
+	State->Release();
+}
+
+EQueuedWorkResult FTaskGroup::Run(IQueuedWork* InQueuedWork)
+{
+	assert(InQueuedWork);
+	State->Add(1);
+	State->Push(InQueuedWork);
+	FGroupTicket* Ticket = new FGroupTicket(State);
+	const EQueuedWorkResult Result = ThreadPool->QueuedThreadWork(Ticket);
+	if (Result != EQueuedWorkResult::Rejected)
+	{
+		return Result;
+	}
+
+	Ticket->Discard();
+	if (!State->Remove(InQueuedWork))
+	{
+		// Executed meanwhile, by a waiter or by the ticket of other work
+		return EQueuedWorkResult::Queued;
+	}
+	State->Done();
+	return EQueuedWorkResult::Rejected;
+}
+
+EQueuedWorkResult FTaskGroup::Run(std::function<void()> Function)
+{
+	IQueuedWork* Work = new FFunctionQueuedWork(std::move(Function));
+	const EQueuedWorkResult Result = Run(Work);
+	if (Result == EQueuedWorkResult::Rejected)
+	{
+		// Deletes the work without running it
+		Work->Abandon();
+	}
+	return Result;
+}
+
+void FTaskGroup::Add(int32 Count /*= 1*/)
+{
+	State->Add(Count);
+}
+
+void FTaskGroup::Done()
+{
+	State->Done();
+}
+
+bool FTaskGroup::IsComplete() const
+{
+	return State->IsComplete();
+}
+
+void FTaskGroup::Wait()
+{
+	State->Wait(ThreadPool);
+}
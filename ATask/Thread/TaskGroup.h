@@ -0,0 +1,179 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include "../HAL/Event.h"
+#include "../HAL/HAL.h"
+#include "IQueuedWork.h"
+#include "QueuedThreadPool.h"
+
+
+/**
+* Waiting that executes pending pool work instead of blocking the thread.
+*
+* A worker waiting on the results of its own children would otherwise hold a pool
+* thread hostage, with enough of them waiting the children never run. The waiter
+* first takes the work it waits for back from the queue and executes it itself,
+* which needs no other thread and nests no deeper than the waits do, so waits on
+* queued work always make progress. It then helps with other queued work; every
+* task executed that way may wait again itself, so that nesting is bounded by
+* MaxHelpDepth per thread. Past it the thread blocks, unless every pool thread
+* blocks in a wait, then nobody else would run the queue.
+*
+* A blocked waiter is registered with the pool and woken by the completion it waits
+* for or by work queued that no idle thread takes, it never polls. With fake threads
+* nothing would wake it, the waits tick them instead, nest up to
+* MaxCooperativeHelpDepth and hitting that is an error.
+*/
+class FHelpingWait
+{
+public:
+	/**
+	* Waits until IsDone returns true, executing work queued on the pool meanwhile.
+	*
+	* @param ThreadPool The pool to help with
+	* @param Event Triggered by the waited on party once done, created here by the first waiter that blocks.
+	*	It resets automatically, a waiter passes a wake up it took on to the next one.
+	* @param IsDone Returns true once the wait is over
+	*/
+	template<typename PredicateType>
+	static void Wait(FQueuedThreadPool* ThreadPool, std::atomic<FEvent*>& Event, PredicateType IsDone)
+	{
+		Wait(ThreadPool, Event, IsDone, []()
+		{
+			return false;
+		});
+	}
+
+	/**
+	* Waits until IsDone returns true, executing work of the waited on party and work queued
+	* on the pool meanwhile.
+	*
+	* @param TryExecuteOwn Executes one piece of the waited on work if there is any, such as work it
+	*	retracted from the queue, returning whether it did
+	*/
+	template<typename PredicateType, typename ExecuteType>
+	static void Wait(FQueuedThreadPool* ThreadPool, std::atomic<FEvent*>& Event, PredicateType IsDone, ExecuteType TryExecuteOwn)
+	{
+		bool bBlocked = false;
+		while (!IsDone())
+		{
+			// Own work first, it is waited for anyway and nests no deeper than the waits do
+			if (TryExecuteOwn() || TryHelp(ThreadPool))
+			{
+				continue;
+			}
+
+			FEvent* WaitEvent = BeginBlocking(ThreadPool, Event);
+			if (WaitEvent == nullptr)
+			{
+				continue;
+			}
+			// The event is triggered after the state changed, checking again after it was published closes the gap
+			if (!IsDone())
+			{
+				WaitEvent->Wait();
+			}
+			bBlocked = true;
+			ThreadPool->RemoveBlockedWaiter(WaitEvent, IsDone());
+		}
+
+		if (bBlocked)
+		{
+			// The completion wakes a single waiter, pass it on to the others waiting for the same party
+			Event.load()->Trigger();
+		}
+	}
+
+	/**
+	* Executes one task queued on the pool, unless the calling thread is nested too deep already
+	* and other pool threads are still running. With fake threads it ticks them when the pool has
+	* nothing queued.
+	*
+	* @return true if a task was executed.
+	*/
+	static bool TryHelp(FQueuedThreadPool* ThreadPool);
+
+	/** @return The number of helping waits the calling thread is nested in. */
+	static int32 GetHelpDepth();
+
+	/** How many helping waits may nest on one thread before it blocks instead, MaxCooperativeHelpDepth with fake threads. */
+	static int32 MaxHelpDepth;
+
+	/** How many helping waits may nest with fake threads, a chain of tasks waiting deeper than that asserts. */
+	static int32 MaxCooperativeHelpDepth;
+
+private:
+	static FEvent* GetOrCreateEvent(std::atomic<FEvent*>& Event);
+
+	/**
+	* Registers the calling thread as blocked with the pool.
+	*
+	* @return The event to wait for, nullptr with fake threads, which the wait has to tick instead.
+	*/
+	static FEvent* BeginBlocking(FQueuedThreadPool* ThreadPool, std::atomic<FEvent*>& Event);
+};
+
+/**
+* Group of tasks that can be waited on as a whole.
+*
+* The tasks are kept in a queue of the group, every task queues a ticket on the pool
+* that executes the oldest one. A waiter executes the newest tasks of its own group
+* first, which never deadlocks however deep the groups nest since it only runs work
+* it waits for anyway, then helps the pool with other work, bounded as FHelpingWait.
+* Run may be called again after a wait to reuse the group.
+*/
+class FTaskGroup
+{
+public:
+	/**
+	* @param InThreadPool The pool the tasks run on, GThreadPool if nullptr
+	*/
+	explicit FTaskGroup(FQueuedThreadPool* InThreadPool = nullptr);
+
+	/** Waits for the pending tasks. */
+	~FTaskGroup();
+
+	FTaskGroup(const FTaskGroup&) = delete;
+	FTaskGroup& operator=(const FTaskGroup&) = delete;
+
+	/**
+	* Queues work as part of the group, subject to the queue capacity of the pool.
+	*
+	* @param InQueuedWork The work, owned as for FQueuedThreadPool::QueuedThreadWork
+	* @return What the pool did with the ticket of the work. Rejected work is not part of the group,
+	*	the caller still owns it.
+	*/
+	EQueuedWorkResult Run(IQueuedWork* InQueuedWork);
+
+	/**
+	* Queues a function as part of the group.
+	*
+	* @return As for Run, a rejected function is discarded.
+	*/
+	EQueuedWorkResult Run(std::function<void()> Function);
+
+	/**
+	* Adds pending items completed by Done, to wait on work not queued through Run.
+	*
+	* @param Count The number of items
+	*/
+	void Add(int32 Count = 1);
+
+	/** Completes one item added with Add. */
+	void Done();
+
+	/** @return true if nothing is pending. */
+	bool IsComplete() const;
+
+	/** Waits until nothing is pending, executing the tasks of the group and other pool work meanwhile. */
+	void Wait();
+
+private:
+	class FGroupState;
+	class FGroupTicket;
+
+	FQueuedThreadPool*	ThreadPool;
+
+	/** Shared with the tickets, which may run after the group is gone. */
+	FGroupState*		State;
+};
@@ -0,0 +1,110 @@
+#include <cassert>
+#include "TaskPipe.h"
+#include "LockProfiler.h"
+#include "QueuedThreadPool.h"
+
+FTaskPipe::FTaskPipe(FQueuedThreadPool* InThreadPool /*= nullptr*/)
+	: ThreadPool(InThreadPool ? InThreadPool : GThreadPool)
+	, NumPendingWorks(0)
+{
+	assert(ThreadPool);
+}
+
+FTaskPipe::~FTaskPipe()
+{
+	assert(IsEmpty() && "Destroying a pipe with pending work");
+}
+
+EQueuedWorkResult FTaskPipe::Launch(IQueuedWork* InQueuedWork)
+{
+	assert(InQueuedWork);
+	{
+		SCOPE_LOCK(&PendingWorksCritical);
+		PendingWorks.push_back(InQueuedWork);
+	}
+	// Only the launch that makes the pipe non-empty schedules it, afterwards the
+	// running dispatch keeps rescheduling itself until the pipe drains.
+	if (NumPendingWorks.fetch_add(1) != 0)
+	{
+		return EQueuedWorkResult::Queued;
+	}
+	const EQueuedWorkResult Result = ThreadPool->QueuedThreadWork(this);
+	if (Result != EQueuedWorkResult::Rejected)
+	{
+		return Result;
+	}
+
+	// Take the work back, the pipe is idle so nothing else takes it out
+	{
+		SCOPE_LOCK(&PendingWorksCritical);
+		for (auto It = PendingWorks.begin(); It != PendingWorks.end(); ++It)
+		{
+			if (*It == InQueuedWork)
+			{
+				PendingWorks.erase(It);
+				break;
+			}
+		}
+	}
+	if (NumPendingWorks.fetch_sub(1) != 1)
+	{
+		// Launched meanwhile and relying on this launch to schedule the pipe, those works are already accepted
+		ThreadPool->QueuedThreadWork(this, true);
+	}
+	return EQueuedWorkResult::Rejected;
+}
+
+EQueuedWorkResult FTaskPipe::Launch(std::function<void()> InFunction)
+{
+	IQueuedWork* Work = new FFunctionQueuedWork(std::move(InFunction));
+	const EQueuedWorkResult Result = Launch(Work);
+	if (Result == EQueuedWorkResult::Rejected)
+	{
+		// Deletes the work without running it
+		Work->Abandon();
+	}
+	return Result;
+}
+
+void FTaskPipe::DoThreadedWork()
+{
+	for (int32 Index = 0; Index < MaxWorksPerDispatch; ++Index)
+	{
+		IQueuedWork* Work = nullptr;
+		{
+			SCOPE_LOCK(&PendingWorksCritical);
+			assert(!PendingWorks.empty());
+			Work = PendingWorks.front();
+			PendingWorks.pop_front();
+		}
+		Work->DoThreadedWork();
+
+		if (NumPendingWorks.fetch_sub(1) == 1)
+		{
+			// Drained, the next Launch schedules the pipe again
+			return;
+		}
+	}
+	// Give other work a chance to run on this thread, requeue for the rest
+	ThreadPool->QueuedThreadWork(this, true);
+}
+
+void FTaskPipe::Abandon()
+{
+	// The pool is shutting down or dropped the pipe, abandon everything still waiting in the pipe
+	std::deque<IQueuedWork*> AbandonedWorks;
+	{
+		SCOPE_LOCK(&PendingWorksCritical);
+		AbandonedWorks.swap(PendingWorks);
+	}
+	for (IQueuedWork* Work : AbandonedWorks)
+	{
+		Work->Abandon();
+	}
+	const int32 NumAbandoned = (int32)AbandonedWorks.size();
+	if (NumPendingWorks.fetch_sub(NumAbandoned) - NumAbandoned > 0)
+	{
+		// Launched after the swap, those launches saw a scheduled pipe and rely on it
+		ThreadPool->QueuedThreadWork(this, true);
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <atomic>
+#include <deque>
+#include <functional>
+#include "../HAL/HAL.h"
+#include "IQueuedWork.h"
+#include "QueuedThreadPool.h"
+
+
+/**
+* A pipe (strand) of queued work.
+*
+* Work launched into a pipe is executed one at a time and in launch order, on
+* whichever pool thread is free. The pipe owns no thread, and no lock is held
+* while a piece of work runs, so an object whose state is only touched from
+* work in its pipe needs no further synchronization. Independent pipes run in
+* parallel with each other.
+*/
+class FTaskPipe : private IQueuedWork
+{
+public:
+	/**
+	* @param InThreadPool The pool whose threads execute the pipe, GThreadPool if nullptr
+	*/
+	explicit FTaskPipe(FQueuedThreadPool* InThreadPool = nullptr);
+
+	/** Destructor, the pipe must be empty. */
+	virtual ~FTaskPipe();
+
+	/**
+	* Appends work to the pipe. It runs after all work launched before it has completed.
+	* Launching into an idle pipe queues the pipe on the pool, subject to the queue capacity.
+	*
+	* @param InQueuedWork The work to execute, owned by the caller as for FQueuedThreadPool::QueuedThreadWork
+	* @return What the pool did with the idle pipe, Queued if the pipe was scheduled already.
+	*	Rejected work is not part of the pipe, the caller still owns it.
+	*/
+	EQueuedWorkResult Launch(IQueuedWork* InQueuedWork);
+
+	/**
+	* Appends a callable to the pipe.
+	*
+	* @param InFunction The function to execute
+	* @return As for Launch, a rejected callable is discarded.
+	*/
+	EQueuedWorkResult Launch(std::function<void()> InFunction);
+
+	/** @return true if there is no work queued or running in the pipe. */
+	bool IsEmpty() const
+	{
+		return NumPendingWorks.load() == 0;
+	}
+
+private:
+	// IQueuedWork interface, the pipe itself is the work scheduled on the pool.
+	virtual void DoThreadedWork() override;
+	virtual void Abandon() override;
+	// Dropping the pipe would abandon every work launched on it, those were accepted already
+	virtual bool CanBeDropped() const override
+	{
+		return false;
+	}
+
+	/** Maximum works executed per pool dispatch before the pipe yields its thread to other work. */
+	static const int32 MaxWorksPerDispatch = 16;
+
+	/** The pool executing this pipe. */
+	FQueuedThreadPool*			ThreadPool;
+
+	/** Works waiting to be executed, in launch order. */
+	std::deque<IQueuedWork*>	PendingWorks;
+
+	/** Guards PendingWorks, only held while pushing or popping. */
+	FCriticalSection			PendingWorksCritical;
+
+	/** Number of works launched and not yet completed, the pipe is scheduled on the pool while this is not zero. */
+	std::atomic<int32>			NumPendingWorks;
+};
@@ -2,57 +2,152 @@
 /*	Implement RunnableThread.h & ThreadManager.h
 */
 /************************************************************************/
+#include <vector>
+#include "Runnable.h"
 #include "RunnableThread.h"
+#include "SingleThreadRunnable.h"
 #include "ThreadManager.h"
-#include "FScopeLock.h"
+#include "LockProfiler.h"
+#include "ThreadCache.h"
 
 ////////////////////////////////////*Thread Manager*//////////////////////////////////////
 
 void FThreadManager::AddThread(uint32 ThreadId, class FRunnableThread* Thread)
 {
-	FScopeLock ThreadsLock(&ThreadsCritical);
+	SCOPE_LOCK(&ThreadsCritical);
 	// Some platforms do not support TLS
-	if (Threads.end() != Threads.find(ThreadId))
+	// A cached OS thread is registered again by every runnable it executes
+	auto Inserted = Threads.insert(std::make_pair(ThreadId, FThreadEntry{ Thread, 0, 0 }));
+	if (Inserted.second)
 	{
-		Threads.insert(std::make_pair(ThreadId, Thread));
+		if (ThreadId >= FirstFakeThreadId)
+		{
+			NumFakeThreads.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+	else
+	{
+		Inserted.first->second.Thread = Thread;
 	}
 }
 
 void FThreadManager::RemoveThread(FRunnableThread* Thread)
 {
-	FScopeLock ThreadsLock(&ThreadsCritical);
-	for (auto it = Threads.begin(); it != Threads.end(); it++)
+	const uint32 CurrentThreadId = FPlatformTLS::GetCurrentThreadId();
+	while (true)
 	{
-		if (it->second == Thread)
 		{
-			Threads.erase(it);
-			break;
+			SCOPE_LOCK(&ThreadsCritical);
+			auto it = Threads.begin();
+			while (it != Threads.end() && it->second.Thread != Thread)
+			{
+				++it;
+			}
+			if (it == Threads.end())
+			{
+				return;
+			}
+			// A thread removing itself from within its own tick must not wait for that tick
+			if (it->second.TickDepth == 0 || it->second.TickingThreadId == CurrentThreadId)
+			{
+				if (it->first >= FirstFakeThreadId)
+				{
+					NumFakeThreads.fetch_sub(1, std::memory_order_relaxed);
+				}
+				Threads.erase(it);
+				return;
+			}
 		}
+		// Ticks are short, wait for the other OS thread to leave the runnable
+		FPlatformProcess::Sleep(0.0f);
 	}
 }
 
-void FThreadManager::Tick()
+bool FThreadManager::Tick(float BudgetSeconds /*= 0.0f*/)
 {
-	if (!FPlatformProcess::SupportsMultithreading())
+	// Fake threads keep depending on Tick whatever multithreading is set to now
+	if (!HasFakeThreads())
+	{
+		return false;
+	}
+
+	const double EndTime = FPlatformTime::Seconds() + BudgetSeconds;
+	const uint32 CurrentThreadId = FPlatformTLS::GetCurrentThreadId();
+	bool bDidWork = false;
+
+	// Ticking may add or remove threads, iterate over a snapshot of the ids and look every one up again
+	std::vector<uint32> ThreadIds;
+	size_t StartIndex = 0;
 	{
-		FScopeLock ThreadsLock(&ThreadsCritical);
+		SCOPE_LOCK(&ThreadsCritical);
+		for (auto it = Threads.lower_bound(FirstFakeThreadId); it != Threads.end(); ++it)
+		{
+			if (it->first < NextTickThreadId)
+			{
+				++StartIndex;
+			}
+			ThreadIds.push_back(it->first);
+		}
+	}
 
-		// Tick all registered threads.
-		for (auto& ThreadPair : Threads)
+	bool bPassDidWork = true;
+	while (bPassDidWork && !ThreadIds.empty())
+	{
+		bPassDidWork = false;
+		for (size_t Step = 0; Step < ThreadIds.size(); ++Step)
+		{
+			const size_t Index = (StartIndex + Step) % ThreadIds.size();
+			const uint32 ThreadId = ThreadIds[Index];
+			FRunnableThread* Thread = nullptr;
+			{
+				SCOPE_LOCK(&ThreadsCritical);
+				auto it = Threads.find(ThreadId);
+				if (it != Threads.end() && (it->second.TickDepth == 0 || it->second.TickingThreadId == CurrentThreadId))
+				{
+					it->second.TickingThreadId = CurrentThreadId;
+					++it->second.TickDepth;
+					Thread = it->second.Thread;
+				}
+			}
+			if (Thread)
+			{
+				// RemoveThread waits for this tick, unless the thread removes itself from within it
+				if (Thread->Tick())
+				{
+					bPassDidWork = true;
+					bDidWork = true;
+				}
+				SCOPE_LOCK(&ThreadsCritical);
+				auto it = Threads.find(ThreadId);
+				if (it != Threads.end() && --it->second.TickDepth == 0)
+				{
+					it->second.TickingThreadId = 0;
+				}
+			}
+			if (BudgetSeconds > 0.0f && FPlatformTime::Seconds() >= EndTime)
+			{
+				SCOPE_LOCK(&ThreadsCritical);
+				NextTickThreadId = ThreadId + 1;
+				return bDidWork;
+			}
+		}
+		// Without a budget every thread is ticked exactly once
+		if (BudgetSeconds <= 0.0f)
 		{
-			ThreadPair.second->Tick();
+			break;
 		}
 	}
+	return bDidWork;
 }
 
 const std::string& FThreadManager::GetThreadName(uint32 ThreadId)
 {
 	static std::string NoThreadName;
-	FScopeLock ThreadsLock(&ThreadsCritical);
+	SCOPE_LOCK(&ThreadsCritical);
 	auto it = Threads.find(ThreadId);
 	if (it != Threads.end())
 	{
-		return it->second->GetThreadName();
+		return it->second.Thread->GetThreadName();
 	}
 	return NoThreadName;
 }
@@ -64,4 +159,211 @@ FThreadManager& FThreadManager::Get()
 }
 
 
-//////////////////////////////////////////////////////////////////////////
\ No newline at end of file
+////////////////////////////////////*Fake Thread*//////////////////////////////////////
+
+/**
+* Thread created when multithreading is not supported. Nothing runs on its own,
+* FThreadManager::Tick ticks the single thread interface of the runnable instead.
+*/
+class FFakeThread : public FRunnableThread
+{
+public:
+	FFakeThread()
+		: bIsSuspended(false)
+		, SingleThreadRunnable(nullptr)
+	{
+		ThreadID = ThreadIdCounter.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	virtual ~FFakeThread()
+	{
+		FThreadManager::Get().RemoveThread(this);
+	}
+
+	virtual bool Tick() override
+	{
+		if (!bIsSuspended && SingleThreadRunnable)
+		{
+			return SingleThreadRunnable->Tick();
+		}
+		return false;
+	}
+
+	virtual void SetThreadPriority(EThreadPriority NewPriority) override
+	{
+		ThreadPriority = NewPriority;
+	}
+
+	virtual void Suspend(bool bShouldPause = true) override
+	{
+		bIsSuspended = bShouldPause;
+	}
+
+	virtual bool Kill(bool bShouldWait = true) override
+	{
+		FThreadManager::Get().RemoveThread(this);
+		if (Runnable)
+		{
+			Runnable->Stop();
+			if (bShouldWait)
+			{
+				TickUntilIdle();
+			}
+			Runnable->Exit();
+			if (bAutoDeleteRunnable)
+			{
+				delete Runnable;
+			}
+			Runnable = nullptr;
+		}
+		SingleThreadRunnable = nullptr;
+		// The runnable is done once killed, as a real thread would be once its Run returned
+		if (bAutoDeleteSelf)
+		{
+			delete this;
+		}
+		return true;
+	}
+
+	virtual void WaitForCompletion() override
+	{
+		// There is no thread to wait for, finish what the runnable has left once nobody else ticks it
+		FThreadManager::Get().RemoveThread(this);
+		TickUntilIdle();
+	}
+
+protected:
+	virtual bool CreateInternal(FRunnable* InRunnable, const TCHAR* InThreadName,
+		uint32 InStackSize = 0,
+		EThreadPriority InThreadPri = TPri_Normal, uint64 InThreadAffinityMask = 0) override
+	{
+		assert(InRunnable);
+		SingleThreadRunnable = InRunnable->GetSingleThreadInterface();
+		if (SingleThreadRunnable == nullptr || !InRunnable->Init())
+		{
+			SingleThreadRunnable = nullptr;
+			return false;
+		}
+		Runnable = InRunnable;
+		ThreadPriority = InThreadPri;
+		ThreadAffinityMask = InThreadAffinityMask;
+		SetThreadName(InThreadName);
+		FThreadManager::Get().AddThread(ThreadID, this);
+		return true;
+	}
+
+private:
+	/** Ticks the runnable until it has no work left, as a real thread would run until its Run returned. */
+	void TickUntilIdle()
+	{
+		while (SingleThreadRunnable && SingleThreadRunnable->Tick())
+		{
+		}
+	}
+
+	/** Ids of fake threads, from FThreadManager::FirstFakeThreadId. */
+	static std::atomic<uint32> ThreadIdCounter;
+
+	bool bIsSuspended;
+	FSingleThreadRunnable* SingleThreadRunnable;
+};
+
+std::atomic<uint32> FFakeThread::ThreadIdCounter(FThreadManager::FirstFakeThreadId);
+
+////////////////////////////////////*Runnable Thread*//////////////////////////////////////
+
+unsigned int FRunnableThread::RunnableTlsSlot = FRunnableThread::GetTlsSlot();
+
+unsigned int FRunnableThread::GetTlsSlot()
+{
+	return FPlatformTLS::AllocTlsSlot();
+}
+
+FRunnableThread::FRunnableThread()
+	: Runnable(nullptr)
+	, ThreadInitSyncEvent(nullptr)
+	, ThreadAffinityMask(FPlatformAffinity::GetNoAffinityMask())
+	, ThreadPriority(TPri_Normal)
+	, ThreadID(0)
+	, bAutoDeleteSelf(false)
+	, bAutoDeleteRunnable(false)
+{
+}
+
+FRunnableThread::~FRunnableThread()
+{
+}
+
+FRunnableThread* FRunnableThread::Create(
+	class FRunnable* InRunnable,
+	const TCHAR* ThreadName,
+	bool bAutoDeleteSelf,
+	bool bAutoDeleteRunnable /*= false*/,
+	uint32 InStackSize /*= 0*/,
+	EThreadPriority InThreadPri /*= TPri_Normal*/,
+	uint64 InThreadAffinityMask /*= 0*/)
+{
+	FRunnableThread* NewThread = nullptr;
+	if (FPlatformProcess::SupportsMultithreading())
+	{
+		// Hand the runnable to a parked thread when the cache is enabled, else start a new OS thread
+		FThreadCache& ThreadCache = FThreadCache::Get();
+		NewThread = ThreadCache.IsEnabled() ? ThreadCache.CreateRunnableThread() : FPlatformProcess::CreateRunnableThread();
+	}
+	else
+	{
+		// Fake threads only work with runnables that implement the single thread interface
+		NewThread = new FFakeThread();
+	}
+	if (NewThread)
+	{
+		NewThread->bAutoDeleteSelf = bAutoDeleteSelf;
+		NewThread->bAutoDeleteRunnable = bAutoDeleteRunnable;
+		// Call the thread's create method
+		if (NewThread->CreateInternal(InRunnable, ThreadName, InStackSize, InThreadPri, InThreadAffinityMask) == false)
+		{
+			// We failed to start the thread correctly so clean up
+			delete NewThread;
+			NewThread = nullptr;
+		}
+	}
+	return NewThread;
+}
+
+FRunnableThread* FRunnableThread::Create(
+	class FRunnable* InRunnable,
+	const TCHAR* ThreadName,
+	uint32 InStackSize /*= 0*/,
+	EThreadPriority InThreadPri /*= TPri_Normal*/,
+	uint64 InThreadAffinityMask /*= FPlatformAffinity::GetNoAffinityMask()*/)
+{
+	return Create(InRunnable, ThreadName, false, false, InStackSize, InThreadPri, InThreadAffinityMask);
+}
+
+void FRunnableThread::SetThreadName(const TCHAR* InThreadName)
+{
+	ThreadName.clear();
+	if (InThreadName != nullptr)
+	{
+		// Thread names are plain ASCII, narrow them
+		for (const TCHAR* Char = InThreadName; *Char; ++Char)
+		{
+			ThreadName.push_back((char)*Char);
+		}
+	}
+}
+
+void FRunnableThread::SetTls()
+{
+	// Make sure it's called from the owning thread.
+	assert(ThreadID == FPlatformTLS::GetCurrentThreadId());
+	FPlatformTLS::SetTlsValue(RunnableTlsSlot, this);
+}
+
+void FRunnableThread::FreeTls()
+{
+	// Make sure it's called from the owning thread.
+	assert(ThreadID == FPlatformTLS::GetCurrentThreadId());
+	FPlatformTLS::SetTlsValue(RunnableTlsSlot, nullptr);
+	TlsInstances.clear();
+}
@@ -0,0 +1,433 @@
+#include <cassert>
+#include "ThreadCache.h"
+#include "Runnable.h"
+#include "RunnableThread.h"
+#include "ThreadManager.h"
+#include "LockProfiler.h"
+#include "../HAL/Event.h"
+
+class FCachedRunnableThread;
+
+/////////////////////////////////////*Cached Thread*/////////////////////////////////////
+/**
+* Runnable of a cached OS thread, runs the runnables assigned to it one after the other.
+*/
+class FCachedThread : public FRunnable
+{
+public:
+	explicit FCachedThread(uint32 InStackBucket)
+		: OSThread(nullptr)
+		, WakeEvent(FPlatformProcess::CreateSynchEvent())
+		, StackBucket(InStackBucket)
+		, AssignedThread(nullptr)
+		, TimeToDie(false)
+	{}
+
+	virtual ~FCachedThread()
+	{
+		delete WakeEvent;
+	}
+
+	/** Wakes the thread up to execute a runnable thread. */
+	void Assign(FCachedRunnableThread* InThread)
+	{
+		assert(AssignedThread.load() == nullptr);
+		AssignedThread.store(InThread);
+		WakeEvent->Trigger();
+	}
+
+	/** Wakes the thread up to exit. */
+	void Terminate()
+	{
+		TimeToDie = true;
+		WakeEvent->Trigger();
+	}
+
+	virtual int Run() override;
+
+	/** The OS thread, deletes itself and this runnable on exit. */
+	FRunnableThread*						OSThread;
+
+	/** Triggered when a runnable is assigned or the thread should exit. */
+	FEvent*									WakeEvent;
+
+	/** The stack size the OS thread was created with. */
+	const uint32							StackBucket;
+
+	/** The runnable thread to execute next. */
+	std::atomic<FCachedRunnableThread*>		AssignedThread;
+
+	/** If true, the thread should exit. */
+	std::atomic<bool>						TimeToDie;
+};
+
+
+/////////////////////////////////////*Cached Runnable Thread*/////////////////////////////////////
+/**
+* Runnable thread executing on a cached OS thread.
+*/
+class FCachedRunnableThread : public FRunnableThread
+{
+public:
+	FCachedRunnableThread()
+		: CachedThread(nullptr)
+		, CompletionEvent(FPlatformProcess::CreateSynchEvent(true))
+		, bStarted(false)
+	{}
+
+	virtual ~FCachedRunnableThread()
+	{
+		if (bStarted)
+		{
+			Kill(true);
+		}
+		delete CompletionEvent;
+	}
+
+	virtual void SetThreadPriority(EThreadPriority NewPriority) override
+	{
+		SCOPE_LOCK(&CachedThreadCritical);
+		ThreadPriority = NewPriority;
+		if (CachedThread != nullptr)
+		{
+			CachedThread->OSThread->SetThreadPriority(NewPriority);
+		}
+	}
+
+	virtual void Suspend(bool bShouldPause = true) override
+	{
+		SCOPE_LOCK(&CachedThreadCritical);
+		if (CachedThread != nullptr)
+		{
+			CachedThread->OSThread->Suspend(bShouldPause);
+		}
+	}
+
+	virtual bool Kill(bool bShouldWait = true) override
+	{
+		{
+			SCOPE_LOCK(&CachedThreadCritical);
+			// Let the runnable have a chance to stop without brute killing
+			if (CachedThread != nullptr && Runnable != nullptr)
+			{
+				Runnable->Stop();
+			}
+		}
+		if (bShouldWait)
+		{
+			WaitForCompletion();
+		}
+		return true;
+	}
+
+	virtual void WaitForCompletion() override
+	{
+		if (bStarted)
+		{
+			CompletionEvent->Wait();
+		}
+	}
+
+	/** Executes the runnable, called on the cached OS thread. */
+	void RunOnCachedThread(FCachedThread* InCachedThread)
+	{
+		FRunnableThread* OSThread = InCachedThread->OSThread;
+		OSThread->SetThreadPriority(ThreadPriority);
+		FPlatformProcess::SetThreadAffinityMask(ThreadAffinityMask);
+		FThreadManager::Get().AddThread(ThreadID, this);
+
+		if (Runnable->Init() == true)
+		{
+			// Initialization has completed, release the sync event
+			ThreadInitSyncEvent->Trigger();
+			ThreadInitSyncEvent = nullptr;
+
+			SetTls();
+			Runnable->Run();
+			Runnable->Exit();
+			FreeTls();
+			// The OS thread goes on running its own runnable
+			FPlatformTLS::SetTlsValue(RunnableTlsSlot, OSThread);
+		}
+		else
+		{
+			// Initialization has failed, release the sync event
+			ThreadInitSyncEvent->Trigger();
+			ThreadInitSyncEvent = nullptr;
+		}
+
+		FThreadManager::Get().RemoveThread(this);
+		FThreadManager::Get().AddThread(ThreadID, OSThread);
+		// Park with the defaults, whatever the runnable changed
+		OSThread->SetThreadPriority(TPri_Normal);
+		FPlatformProcess::SetThreadAffinityMask(0);
+
+		{
+			SCOPE_LOCK(&CachedThreadCritical);
+			CachedThread = nullptr;
+			if (bAutoDeleteRunnable)
+			{
+				delete Runnable;
+			}
+			Runnable = nullptr;
+		}
+	}
+
+	/** Releases threads waiting for the runnable to exit, called on the cached OS thread after RunOnCachedThread. */
+	void SignalCompletion()
+	{
+		// Nothing may touch this once the waiting thread is released
+		if (bAutoDeleteSelf)
+		{
+			bStarted = false;
+			delete this;
+		}
+		else
+		{
+			CompletionEvent->Trigger();
+		}
+	}
+
+protected:
+	virtual bool CreateInternal(FRunnable* InRunnable, const TCHAR* InThreadName,
+		uint32 InStackSize = 0,
+		EThreadPriority InThreadPri = TPri_Normal, uint64 InThreadAffinityMask = 0) override
+	{
+		assert(InRunnable);
+		// Checked before acquiring, a thread taken from the cache has to be assigned
+		if (CompletionEvent == nullptr)
+		{
+			return false;
+		}
+		FCachedThread* Thread = FThreadCache::Get().AcquireThread(FThreadCache::GetStackSizeBucket(InStackSize));
+		if (Thread == nullptr)
+		{
+			return false;
+		}
+
+		Runnable = InRunnable;
+		ThreadPriority = InThreadPri;
+		ThreadAffinityMask = InThreadAffinityMask;
+		ThreadID = Thread->OSThread->GetThreadID();
+		SetThreadName(InThreadName);
+		CachedThread = Thread;
+		bStarted = true;
+
+		// Same guarantee as a new thread, Create returns once Init() has been called.
+		// An auto deleting thread may be gone once this returns, so nothing touches this afterwards
+		FEvent* InitSyncEvent = FPlatformProcess::CreateSynchEvent(true);
+		ThreadInitSyncEvent = InitSyncEvent;
+		Thread->Assign(this);
+		InitSyncEvent->Wait();
+		delete InitSyncEvent;
+		return true;
+	}
+
+private:
+	/** The OS thread executing the runnable, nullptr once it has exited. */
+	FCachedThread*		CachedThread;
+
+	/** Guards CachedThread against the runnable exiting. */
+	FCriticalSection	CachedThreadCritical;
+
+	/** Triggered when the runnable has exited. */
+	FEvent*				CompletionEvent;
+
+	/** Whether the runnable was handed to a thread. */
+	bool				bStarted;
+};
+
+
+int FCachedThread::Run()
+{
+	while (true)
+	{
+		const bool bWoken = WakeEvent->Wait(FThreadCache::Get().IdleTimeoutMs.load(std::memory_order_relaxed));
+		if (TimeToDie)
+		{
+			break;
+		}
+		if (!bWoken)
+		{
+			if (FThreadCache::Get().RemoveIdleThread(this))
+			{
+				break;
+			}
+			// Acquired while timing out, the assignment is about to wake us
+			continue;
+		}
+
+		FCachedRunnableThread* Thread = AssignedThread.exchange(nullptr);
+		assert(Thread);
+		Thread->RunOnCachedThread(this);
+
+		// Park before releasing the waiter, so that a thread created right after the join finds this one warm
+		const bool bParked = FThreadCache::Get().ReturnThread(this);
+		Thread->SignalCompletion();
+		if (!bParked)
+		{
+			break;
+		}
+	}
+	return 0;
+}
+
+
+/////////////////////////////////////*Thread Cache*/////////////////////////////////////
+FThreadCache::FThreadCache()
+	: NumParkedThreads(0)
+	, MaxCachedThreads(0)
+	, IdleTimeoutMs(30 * 1000)
+{
+}
+
+void FThreadCache::SetMaxCachedThreads(int32 InMaxCachedThreads)
+{
+	SCOPE_LOCK(&CacheCritical);
+	MaxCachedThreads = InMaxCachedThreads;
+	// Trim the cache down to the new size
+	for (auto& BucketPair : ParkedThreads)
+	{
+		while (NumParkedThreads > MaxCachedThreads && !BucketPair.second.empty())
+		{
+			BucketPair.second.back()->Terminate();
+			BucketPair.second.pop_back();
+			--NumParkedThreads;
+		}
+	}
+}
+
+void FThreadCache::SetIdleTimeout(uint32 InIdleTimeoutMs)
+{
+	IdleTimeoutMs.store(InIdleTimeoutMs, std::memory_order_relaxed);
+}
+
+void FThreadCache::Prewarm(int32 NumThreads, uint32 InStackSize /*= 0*/)
+{
+	if (!FPlatformProcess::SupportsMultithreading())
+	{
+		// Fake threads are never cached
+		return;
+	}
+	const uint32 StackBucket = GetStackSizeBucket(InStackSize);
+	for (int32 Index = 0; Index < NumThreads; ++Index)
+	{
+		FCachedThread* Thread = SpawnThread(StackBucket);
+		if (Thread == nullptr)
+		{
+			break;
+		}
+		if (!ReturnThread(Thread))
+		{
+			// The cache is full
+			Thread->Terminate();
+			break;
+		}
+	}
+}
+
+void FThreadCache::Shutdown()
+{
+	SCOPE_LOCK(&CacheCritical);
+	MaxCachedThreads = 0;
+	for (auto& BucketPair : ParkedThreads)
+	{
+		for (FCachedThread* Thread : BucketPair.second)
+		{
+			Thread->Terminate();
+		}
+	}
+	ParkedThreads.clear();
+	NumParkedThreads = 0;
+}
+
+uint32 FThreadCache::GetStackSizeBucket(uint32 InStackSize)
+{
+	if (InStackSize == 0)
+	{
+		return 0;
+	}
+	// Power of two buckets, starting at 16KB
+	uint32 StackBucket = 16 * 1024;
+	while (StackBucket < InStackSize && StackBucket < 0x80000000u)
+	{
+		StackBucket <<= 1;
+	}
+	return StackBucket;
+}
+
+FThreadCache& FThreadCache::Get()
+{
+	// Never destroyed, cached threads may still return themselves while the process exits
+	static FThreadCache* Singleton = new FThreadCache();
+	return *Singleton;
+}
+
+FRunnableThread* FThreadCache::CreateRunnableThread()
+{
+	return new FCachedRunnableThread();
+}
+
+FCachedThread* FThreadCache::AcquireThread(uint32 StackBucket)
+{
+	{
+		SCOPE_LOCK(&CacheCritical);
+		auto It = ParkedThreads.find(StackBucket);
+		if (It != ParkedThreads.end() && !It->second.empty())
+		{
+			// Most recently parked first, its stack is the most likely to still be cached
+			FCachedThread* Thread = It->second.back();
+			It->second.pop_back();
+			--NumParkedThreads;
+			return Thread;
+		}
+	}
+	return SpawnThread(StackBucket);
+}
+
+FCachedThread* FThreadCache::SpawnThread(uint32 StackBucket)
+{
+	FCachedThread* Thread = new FCachedThread(StackBucket);
+	FRunnableThread* OSThread = FPlatformProcess::CreateRunnableThread();
+	OSThread->bAutoDeleteSelf = true;
+	OSThread->bAutoDeleteRunnable = true;
+	Thread->OSThread = OSThread;
+	if (Thread->WakeEvent == nullptr || !OSThread->CreateInternal(Thread, TEXT("CachedThread"), StackBucket, TPri_Normal, 0))
+	{
+		delete OSThread;
+		delete Thread;
+		return nullptr;
+	}
+	return Thread;
+}
+
+bool FThreadCache::ReturnThread(FCachedThread* Thread)
+{
+	SCOPE_LOCK(&CacheCritical);
+	if (NumParkedThreads >= MaxCachedThreads)
+	{
+		return false;
+	}
+	ParkedThreads[Thread->StackBucket].push_back(Thread);
+	++NumParkedThreads;
+	return true;
+}
+
+bool FThreadCache::RemoveIdleThread(FCachedThread* Thread)
+{
+	SCOPE_LOCK(&CacheCritical);
+	auto It = ParkedThreads.find(Thread->StackBucket);
+	if (It != ParkedThreads.end())
+	{
+		for (auto ThreadIt = It->second.begin(); ThreadIt != It->second.end(); ++ThreadIt)
+		{
+			if (*ThreadIt == Thread)
+			{
+				It->second.erase(ThreadIt);
+				--NumParkedThreads;
+				return true;
+			}
+		}
+	}
+	return false;
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <atomic>
+#include <map>
+#include <vector>
+#include "../HAL/HAL.h"
+
+class FRunnableThread;
+class FCachedThread;
+
+/**
+* Cache of parked OS threads.
+*
+* When enabled, FRunnableThread::Create hands the runnable to a parked thread of
+* the requested stack size bucket instead of creating a new OS thread, applying
+* the requested priority and affinity. Once the runnable has exited, the thread
+* goes back to normal priority and no affinity and parks itself in the cache again.
+* Parked threads exit after an idle timeout or when the cache is full.
+*
+* The cache is disabled until SetMaxCachedThreads enables it.
+*/
+class FThreadCache
+{
+public:
+	FThreadCache();
+
+	/** @return true if FRunnableThread::Create goes through the cache. */
+	bool IsEnabled() const
+	{
+		return MaxCachedThreads.load(std::memory_order_relaxed) > 0;
+	}
+
+	/**
+	* Sets how many threads may be parked at once, 0 disables the cache.
+	*
+	* @param InMaxCachedThreads The maximum number of parked threads
+	*/
+	void SetMaxCachedThreads(int32 InMaxCachedThreads);
+
+	/**
+	* Sets how long a thread stays parked before it exits.
+	*
+	* @param InIdleTimeoutMs The timeout in milliseconds, UINT_MAX to never time out
+	*/
+	void SetIdleTimeout(uint32 InIdleTimeoutMs);
+
+	/**
+	* Starts parked threads ahead of time, so that the first creations are warm too.
+	*
+	* @param NumThreads Number of threads to start, limited by the cache size
+	* @param InStackSize The stack size the threads are created for
+	*/
+	void Prewarm(int32 NumThreads, uint32 InStackSize = 0);
+
+	/** Tells all parked threads to exit and disables the cache. Running threads exit once their runnable has. */
+	void Shutdown();
+
+	/**
+	* Rounds a stack size up to the size cached threads are created with.
+	*
+	* @param InStackSize The requested stack size, 0 means the default stack size
+	* @return The bucket stack size
+	*/
+	static uint32 GetStackSizeBucket(uint32 InStackSize);
+
+	/**
+	* Access to the singleton object.
+	*
+	* @return Thread cache object.
+	*/
+	static FThreadCache& Get();
+
+private:
+	friend class FRunnableThread;
+	friend class FCachedThread;
+	friend class FCachedRunnableThread;
+
+	/** Creates a runnable thread that executes on a cached OS thread, FRunnableThread::Create starts it. */
+	FRunnableThread* CreateRunnableThread();
+
+	/** Takes a parked thread of the bucket, or starts a new one if there is none. */
+	FCachedThread* AcquireThread(uint32 StackBucket);
+
+	/** Starts a new OS thread for the bucket, not parked. */
+	FCachedThread* SpawnThread(uint32 StackBucket);
+
+	/** Parks a thread whose runnable has exited. @return false if the thread should exit instead. */
+	bool ReturnThread(FCachedThread* Thread);
+
+	/** Removes a thread whose idle timeout elapsed. @return false if it was acquired meanwhile and must keep running. */
+	bool RemoveIdleThread(FCachedThread* Thread);
+
+	/** Parked threads per stack size bucket. */
+	std::map<uint32, std::vector<FCachedThread*>> ParkedThreads;
+
+	/** Number of threads in ParkedThreads. */
+	int32 NumParkedThreads;
+
+	/** Maximum number of parked threads, 0 until the cache is enabled. */
+	std::atomic<int32> MaxCachedThreads;
+
+	/** Milliseconds a thread stays parked before it exits, read by the parked threads. */
+	std::atomic<uint32> IdleTimeoutMs;
+
+	/** Guards the parked threads. */
+	FCriticalSection CacheCritical;
+};
@@ -1,16 +1,39 @@
 #pragma once
 #include "../HAL/HAL.h"
+#include <atomic>
 #include <map>
 #include <string.h>
 
 class FThreadManager
 {
+	/** A registered thread, with the OS thread ticking it if it is a fake thread being ticked. */
+	struct FThreadEntry
+	{
+		class FRunnableThread* Thread;
+		/** Id of the OS thread ticking the thread, 0 while nobody does. */
+		uint32 TickingThreadId;
+		/** How often the ticking OS thread is nested in ticks of the thread. */
+		int32 TickDepth;
+	};
+
 	/** List of thread objects to be ticked. */
-	std::map<uint32, class FRunnableThread*> Threads;
+	std::map<uint32, FThreadEntry> Threads;
 	/** Critical section for ThreadList */
 	FCriticalSection ThreadsCritical;
+	/** Id of the thread the next Tick starts with, so that an exhausted budget does not always starve the same threads. */
+	uint32 NextTickThreadId;
+	/** Number of fake threads in Threads. */
+	std::atomic<int32> NumFakeThreads;
+
+	FThreadManager()
+		: NextTickThreadId(FirstFakeThreadId)
+		, NumFakeThreads(0)
+	{}
 
 public:
+	/** Ids of fake threads start here, above the ids of OS threads. */
+	static const uint32 FirstFakeThreadId = 0xF0000000;
+
 	/**
 	* Used internally to add a new thread object.
 	*
@@ -20,15 +43,36 @@ public:
 	void AddThread(uint32 ThreadId, class FRunnableThread* Thread);
 
 	/**
-	* Used internally to remove thread object.
+	* Used internally to remove thread object. Waits while another OS thread ticks it,
+	* once this returns the thread is not ticked anymore.
 	*
 	* @param Thread thread object to be removed.
 	* @see AddThread
 	*/
 	void RemoveThread(class FRunnableThread* Thread);
 
-	/** Ticks all fake threads and their runnable objects. */
-	void Tick();
+	/**
+	* Ticks all fake threads and their runnable objects, round robin.
+	*
+	* With a budget, the threads are ticked again for as long as any of them did work
+	* and the budget is not used up, the next Tick continues with the thread after the
+	* last one ticked. Does nothing when there are no fake threads, which keep running
+	* on Tick even if multithreading was enabled again after they were created.
+	*
+	* The runnables are ticked outside of the thread list lock. A thread ticked by
+	* another OS thread at the same time is skipped, nested ticks on one OS thread
+	* may tick it again.
+	*
+	* @param BudgetSeconds How long to keep ticking, 0 ticks every thread once
+	* @return true if any runnable did work.
+	*/
+	bool Tick(float BudgetSeconds = 0.0f);
+
+	/** @return true if there are fake threads, which only make progress while they are ticked. */
+	bool HasFakeThreads() const
+	{
+		return NumFakeThreads.load(std::memory_order_relaxed) != 0;
+	}
 
 	/** Returns the name of a thread given its TLS id */
 	const std::string& GetThreadName(uint32 ThreadId);
@@ -1,4 +1,5 @@
 #pragma once
+#include "../HAL/HAL.h"
 /**
 * The list of enumerated thread priorities we support
 */
@@ -0,0 +1,122 @@
+#include <string>
+#include <vector>
+#include "TestFramework.h"
+#include "TestHelpers.h"
+#include "Thread/Future.h"
+#include "Thread/QueuedThreadPool.h"
+
+TEST_CASE(Future_ThenChainsValues)
+{
+	TFuture<int32> A = Async([]() { return 20; });
+	TFuture<std::string> B = A.Then([](int32 Value) { return std::to_string(Value + 1); });
+	TFuture<size_t> C = B.Then([](const std::string& Value) { return Value.size(); });
+	CHECK(B.Get() == "21");
+	CHECK(C.Get() == 2);
+
+	// Continuations of a future completed later run once it completes
+	TPromise<int32> Promise;
+	TFuture<int32> Doubled = Promise.GetFuture().Then([](int32 Value) { return Value * 2; });
+	CHECK(!Doubled.IsReady());
+	Promise.SetValue(5);
+	CHECK(Doubled.Get() == 10);
+}
+
+TEST_CASE(Future_WhenAllCompletesAfterEveryFuture)
+{
+	std::vector<TFuture<int32>> Futures;
+	for (int32 Index = 0; Index < 10; ++Index)
+	{
+		Futures.push_back(Async([Index]() { return Index; }));
+	}
+	TFuture<void> All = WhenAll(Futures);
+	All.Wait();
+	CHECK(All.GetError() == EFutureError::None);
+	for (int32 Index = 0; Index < 10; ++Index)
+	{
+		CHECK(Futures[Index].IsReady());
+		CHECK(Futures[Index].Get() == Index);
+	}
+}
+
+TEST_CASE(Future_WhenAllReportsFirstError)
+{
+	TPromise<int32> A;
+	TPromise<int32> B;
+	std::vector<TFuture<int32>> Futures;
+	Futures.push_back(A.GetFuture());
+	Futures.push_back(B.GetFuture());
+	TFuture<void> All = WhenAll(Futures);
+	A.SetError(EFutureError::Rejected);
+	CHECK(!All.IsReady());
+	B.SetValue(2);
+	All.Wait();
+	CHECK(All.GetError() == EFutureError::Rejected);
+}
+
+TEST_CASE(Future_WhenAnyReturnsFirstIndex)
+{
+	TPromise<int32> A;
+	TPromise<int32> B;
+	std::vector<TFuture<int32>> Futures;
+	Futures.push_back(A.GetFuture());
+	Futures.push_back(B.GetFuture());
+	TFuture<int32> Any = WhenAny(Futures);
+	CHECK(!Any.IsReady());
+	B.SetValue(1);
+	CHECK(Any.Get() == 1);
+	A.SetValue(0);
+	CHECK(Any.Get() == 1);
+}
+
+TEST_CASE(Future_BrokenPromise)
+{
+	TFuture<int32> Future;
+	{
+		TPromise<int32> Promise;
+		Future = Promise.GetFuture();
+	}
+	Future.Wait();
+	CHECK(Future.GetError() == EFutureError::BrokenPromise);
+
+	// Errors pass down a chain without running the continuations
+	bool bRan = false;
+	TFuture<void> Continuation = Future.Then([&bRan](int32) { bRan = true; });
+	Continuation.Wait();
+	CHECK(Continuation.GetError() == EFutureError::BrokenPromise);
+	CHECK(!bRan);
+}
+
+TEST_CASE(Future_LongChainRunsInline)
+{
+	// Completing the root with a full RunInline queue would otherwise recurse down the whole chain
+	FQueuedThreadPool* ThreadPool = FQueuedThreadPool::Allocate();
+	ThreadPool->Create(2);
+	ThreadPool->SetQueueCapacity(1, EQueueOverflowPolicy::RunInline);
+	const int32 ChainLength = 10000;
+	TPromise<int32> Root(ThreadPool);
+	TFuture<int32> Future = Root.GetFuture();
+	for (int32 Index = 0; Index < ChainLength; ++Index)
+	{
+		Future = Future.Then([](int32 Value) { return Value + 1; });
+	}
+	Root.SetValue(0);
+	CHECK(Future.Get() == ChainLength);
+	ThreadPool->Destory();
+	delete ThreadPool;
+}
+
+TEST_CASE(Future_WaitRunsQueuedProducer)
+{
+	// The only pool thread is busy, the waiting thread has to run the producer itself
+	FQueuedThreadPool* ThreadPool = FQueuedThreadPool::Allocate();
+	ThreadPool->Create(1);
+	{
+		FPoolBlocker Blocker(ThreadPool);
+		uint32 ThreadId = 0;
+		TFuture<int32> Future = Async([&ThreadId]() { ThreadId = FPlatformTLS::GetCurrentThreadId(); return 42; }, ThreadPool);
+		CHECK(Future.Get() == 42);
+		CHECK(ThreadId == FPlatformTLS::GetCurrentThreadId());
+	}
+	ThreadPool->Destory();
+	delete ThreadPool;
+}
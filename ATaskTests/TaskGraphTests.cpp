@@ -0,0 +1,182 @@
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include "TestFramework.h"
+#include "TestHelpers.h"
+#include "TaskGraph/IncrementalTaskGraph.h"
+#include "TaskGraph/StaticTaskGraph.h"
+#include "TaskGraph/TaskGraphTypes.h"
+#include "Thread/QueuedThreadPool.h"
+
+TEST_CASE(StaticTaskGraph_RunsInTopologicalOrder)
+{
+	typedef TStaticTaskGraphLayout<5, TStaticTaskEdge<0, 1>, TStaticTaskEdge<0, 2>, TStaticTaskEdge<1, 3>, TStaticTaskEdge<2, 3>, TStaticTaskEdge<4, 3>> FLayout;
+	TStaticTaskGraph<FLayout> Graph;
+	std::atomic<int32> Order[5];
+	std::atomic<int32> Counter(0);
+	for (int32 Index = 0; Index < 5; ++Index)
+	{
+		Graph.SetTask(Index, [&Order, &Counter, Index]() { Order[Index] = Counter++; });
+	}
+	for (int32 Run = 0; Run < 200; ++Run)
+	{
+		Counter = 0;
+		Graph.Execute();
+		CHECK(Counter == 5);
+		CHECK(Order[0] < Order[1] && Order[0] < Order[2]);
+		CHECK(Order[1] < Order[3] && Order[2] < Order[3] && Order[4] < Order[3]);
+	}
+}
+
+TEST_CASE(StaticTaskGraph_RunsCriticalPathFirst)
+{
+	// Chain 0->1->2->3 takes longer than all the independent nodes 4..7 together
+	typedef TStaticTaskGraphLayout<8, TStaticTaskEdge<0, 1>, TStaticTaskEdge<1, 2>, TStaticTaskEdge<2, 3>> FLayout;
+	FQueuedThreadPool* ThreadPool = FQueuedThreadPool::Allocate();
+	ThreadPool->Create(1);
+	std::vector<int32> Order;
+	{
+		TStaticTaskGraph<FLayout> Graph(ThreadPool);
+		std::mutex OrderMutex;
+		for (int32 Index = 0; Index < 8; ++Index)
+		{
+			Graph.SetTask(Index, [&Order, &OrderMutex, Index]()
+			{
+				{
+					std::lock_guard<std::mutex> Lock(OrderMutex);
+					Order.push_back(Index);
+				}
+				SpinFor(Index < 4 ? 0.002 : 0.0005);
+			}, Index < 4 ? "Chain" : "Filler");
+		}
+		// The first execution measures the nodes, the second ranks them
+		Graph.Execute();
+		Graph.Execute();
+		CHECK(Graph.GetEstimatedCriticalPathSeconds() >= 0.008);
+
+		// With the pool thread busy everything runs on this thread, in rank order
+		FPoolBlocker Blocker(ThreadPool);
+		Order.clear();
+		Graph.Execute();
+	}
+	CHECK(Order.size() == 8);
+	for (int32 Index = 0; Index < 4 && Index < (int32)Order.size(); ++Index)
+	{
+		CHECK(Order[Index] == Index);
+	}
+	ThreadPool->Destory();
+	delete ThreadPool;
+}
+
+typedef TStaticTaskGraphLayout<4, TStaticTaskEdge<0, 3>, TStaticTaskEdge<1, 3>, TStaticTaskEdge<2, 3>> FNestedLayout;
+
+static void ExecuteNested(int32 Depth, std::atomic<int32>& NumRuns)
+{
+	TStaticTaskGraph<FNestedLayout> Graph;
+	for (int32 Index = 0; Index < 4; ++Index)
+	{
+		Graph.SetTask(Index, [Depth, &NumRuns]()
+		{
+			++NumRuns;
+			if (Depth > 0)
+			{
+				ExecuteNested(Depth - 1, NumRuns);
+			}
+		});
+	}
+	Graph.Execute();
+}
+
+TEST_CASE(StaticTaskGraph_NestedExecutions)
+{
+	std::atomic<int32> NumRuns(0);
+	ExecuteNested(3, NumRuns);
+	CHECK(NumRuns == 4 + 16 + 64 + 256);
+}
+
+TEST_CASE(IncrementalTaskGraph_PropagatesDirtyWithEarlyCutoff)
+{
+	// Inputs A[i], B[i] = A[i] / 10 cuts off most changes, Sum adds up B
+	const int32 NumInputs = 50;
+	FIncrementalTaskGraph Graph;
+	std::vector<int32> A(NumInputs);
+	std::vector<int32> B(NumInputs);
+	std::vector<FIncrementalTaskGraph::FNodeId> AIds(NumInputs);
+	std::vector<FIncrementalTaskGraph::FNodeId> BIds(NumInputs);
+	int32 Sum = 0;
+	for (int32 Index = 0; Index < NumInputs; ++Index)
+	{
+		A[Index] = Index * 10;
+		AIds[Index] = Graph.AddNode([&A, Index]() { return (uint64)A[Index]; });
+		BIds[Index] = Graph.AddCachedNode(B[Index], [&A, Index]() { return A[Index] / 10; });
+		CHECK(Graph.AddDependency(AIds[Index], BIds[Index]));
+	}
+	const FIncrementalTaskGraph::FNodeId SumId = Graph.AddCachedNode(Sum, [&B]()
+	{
+		int32 Total = 0;
+		for (int32 Value : B)
+		{
+			Total += Value;
+		}
+		return Total;
+	});
+	for (int32 Index = 0; Index < NumInputs; ++Index)
+	{
+		Graph.AddDependency(BIds[Index], SumId);
+	}
+	CHECK(!Graph.AddDependency(SumId, AIds[0]));
+
+	FIncrementalExecutionStats Stats = Graph.Execute();
+	CHECK(Stats.NumExecuted == 2 * NumInputs + 1);
+	CHECK(Sum == NumInputs * (NumInputs - 1) / 2);
+
+	Stats = Graph.Execute();
+	CHECK(Stats.NumAffected == 0);
+
+	// B[3] stays 3, nothing past it is recomputed
+	A[3] = 31;
+	Graph.MarkDirty(AIds[3]);
+	Stats = Graph.Execute();
+	CHECK(Stats.NumExecuted == 2);
+	CHECK(Stats.NumCutoff == 1);
+
+	// B[5] changes, the sum follows
+	A[5] = 100;
+	Graph.MarkDirty(AIds[5]);
+	Stats = Graph.Execute();
+	CHECK(Stats.NumExecuted == 3);
+	CHECK(Sum == NumInputs * (NumInputs - 1) / 2 + 5);
+	CHECK(!Graph.IsDirty(SumId));
+}
+
+TEST_CASE(IncrementalTaskGraph_RunsRefusedNodesOnCaller)
+{
+	FQueuedThreadPool* ThreadPool = FQueuedThreadPool::Allocate();
+	ThreadPool->Create(1);
+	ThreadPool->SetQueueCapacity(1, EQueueOverflowPolicy::Reject);
+	{
+		const int32 Width = 32;
+		FIncrementalTaskGraph Graph(ThreadPool);
+		std::vector<int32> Outputs(Width, 0);
+		std::vector<FIncrementalTaskGraph::FNodeId> Ids(Width);
+		int32 Input = 1;
+		const FIncrementalTaskGraph::FNodeId InputId = Graph.AddNode([&Input]() { return (uint64)Input; });
+		for (int32 Index = 0; Index < Width; ++Index)
+		{
+			Ids[Index] = Graph.AddCachedNode(Outputs[Index], [&Input, Index]() { return Input * Index; });
+			Graph.AddDependency(InputId, Ids[Index]);
+		}
+		Graph.Execute();
+		Input = 2;
+		Graph.MarkDirty(InputId);
+		const FIncrementalExecutionStats Stats = Graph.Execute();
+		CHECK(Stats.NumExecuted == Width + 1);
+		for (int32 Index = 0; Index < Width; ++Index)
+		{
+			CHECK(Outputs[Index] == 2 * Index);
+			CHECK(!Graph.IsDirty(Ids[Index]));
+		}
+	}
+	ThreadPool->Destory();
+	delete ThreadPool;
+}
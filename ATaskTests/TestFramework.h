@@ -0,0 +1,65 @@
+#pragma once
+#include <vector>
+#include "HAL/HAL.h"
+
+/**
+* Minimal test registry of the ATaskTests executable.
+*
+* Tests are plain functions registered before main runs, checks record a failure and
+* carry on rather than asserting, so they also run in Release where assert is compiled out:
+*	TEST_CASE(TaskPipe_RunsInLaunchOrder)
+*	{
+*		CHECK(Pipe.IsEmpty());
+*	}
+*/
+class FTestRegistry
+{
+public:
+	typedef void (*FTestFunction)();
+
+	struct FTestCase
+	{
+		const char*		Name;
+		FTestFunction	Function;
+	};
+
+	/** Adds a test, called by TEST_CASE. */
+	static void Add(const char* Name, FTestFunction Function);
+
+	/**
+	* Records the outcome of a check, printing the failed ones.
+	*
+	* @return Whether the check passed.
+	*/
+	static bool Check(bool bPassed, const char* Expression, const char* File, int32 Line);
+
+	/**
+	* Runs the tests whose name contains a filter.
+	*
+	* @param Filter Part of the names of the tests to run, nullptr for all
+	* @return The number of tests that failed.
+	*/
+	static int32 RunAll(const char* Filter);
+
+private:
+	static std::vector<FTestCase>& GetTests();
+
+	/** Failed checks of the running test. */
+	static int32 NumFailedChecks;
+};
+
+/** Registers a test function defined at static initialization. */
+struct FTestRegistrar
+{
+	FTestRegistrar(const char* Name, FTestRegistry::FTestFunction Function)
+	{
+		FTestRegistry::Add(Name, Function);
+	}
+};
+
+#define TEST_CASE(Name) \
+	static void Name(); \
+	static FTestRegistrar Name##Registrar(#Name, &Name); \
+	static void Name()
+
+#define CHECK(Expression) FTestRegistry::Check(!!(Expression), #Expression, __FILE__, __LINE__)
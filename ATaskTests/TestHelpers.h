@@ -0,0 +1,66 @@
+#pragma once
+#include <atomic>
+#include "HAL/HAL.h"
+#include "Thread/IQueuedWork.h"
+#include "Thread/QueuedThreadPool.h"
+
+/**
+* Keeps the only thread of a pool busy until released, so that work queued meanwhile
+* stays in the queue.
+*/
+class FPoolBlocker
+{
+public:
+	explicit FPoolBlocker(FQueuedThreadPool* ThreadPool)
+		: bStarted(false)
+		, bReleased(false)
+		, bFinished(false)
+	{
+		ThreadPool->QueuedThreadWork(new FFunctionQueuedWork([this]()
+		{
+			bStarted = true;
+			while (!bReleased)
+			{
+				FPlatformProcess::Sleep(0.001f);
+			}
+			bFinished = true;
+		}));
+		while (!bStarted)
+		{
+			FPlatformProcess::Sleep(0.001f);
+		}
+	}
+
+	/** Releases the thread if it was not released yet. */
+	~FPoolBlocker()
+	{
+		Release();
+	}
+
+	/** Lets the thread go on with the queued work. */
+	void Release()
+	{
+		bReleased = true;
+		while (!bFinished)
+		{
+			FPlatformProcess::Sleep(0.001f);
+		}
+	}
+
+	FPoolBlocker(const FPoolBlocker&) = delete;
+	FPoolBlocker& operator=(const FPoolBlocker&) = delete;
+
+private:
+	std::atomic<bool> bStarted;
+	std::atomic<bool> bReleased;
+	std::atomic<bool> bFinished;
+};
+
+/** Spins for a while, standing in for work of a known duration. */
+inline void SpinFor(double Seconds)
+{
+	const double EndSeconds = FPlatformTime::Seconds() + Seconds;
+	while (FPlatformTime::Seconds() < EndSeconds)
+	{
+	}
+}
@@ -0,0 +1,78 @@
+#include <cstring>
+#include <iostream>
+#include "TestFramework.h"
+#include "Thread/QueuedThreadPool.h"
+
+using namespace std;
+
+int32 FTestRegistry::NumFailedChecks = 0;
+
+std::vector<FTestRegistry::FTestCase>& FTestRegistry::GetTests()
+{
+	static std::vector<FTestCase> Tests;
+	return Tests;
+}
+
+void FTestRegistry::Add(const char* Name, FTestFunction Function)
+{
+	FTestCase Test;
+	Test.Name = Name;
+	Test.Function = Function;
+	GetTests().push_back(Test);
+}
+
+bool FTestRegistry::Check(bool bPassed, const char* Expression, const char* File, int32 Line)
+{
+	if (!bPassed)
+	{
+		++NumFailedChecks;
+		cout << File << "(" << Line << "): check failed: " << Expression << endl;
+	}
+	return bPassed;
+}
+
+int32 FTestRegistry::RunAll(const char* Filter)
+{
+	int32 NumRun = 0;
+	int32 NumFailed = 0;
+	for (const FTestCase& Test : GetTests())
+	{
+		if (Filter != nullptr && strstr(Test.Name, Filter) == nullptr)
+		{
+			continue;
+		}
+		cout << "[ RUN    ] " << Test.Name << endl;
+		NumFailedChecks = 0;
+		Test.Function();
+		++NumRun;
+		if (NumFailedChecks != 0)
+		{
+			++NumFailed;
+			cout << "[ FAILED ] " << Test.Name << endl;
+		}
+		else
+		{
+			cout << "[     OK ] " << Test.Name << endl;
+		}
+	}
+	cout << NumRun << " test(s) run, " << NumFailed << " failed" << endl;
+	return NumFailed;
+}
+
+/**
+* Runs the tests, or the ones whose name contains the first argument.
+* The exit code is the number of failed tests.
+*/
+int main(int argc, char* argv[])
+{
+	// The default pool, tests needing particular pool settings create their own
+	GThreadPool = FQueuedThreadPool::Allocate();
+	GThreadPool->Create(4);
+
+	const int32 NumFailed = FTestRegistry::RunAll(argc > 1 ? argv[1] : nullptr);
+
+	GThreadPool->Destory();
+	delete GThreadPool;
+	GThreadPool = nullptr;
+	return NumFailed;
+}
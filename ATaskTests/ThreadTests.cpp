@@ -0,0 +1,324 @@
+#include <atomic>
+#include <set>
+#include <vector>
+#include "TestFramework.h"
+#include "TestHelpers.h"
+#include "Thread/Future.h"
+#include "Thread/IQueuedWork.h"
+#include "Thread/QueuedThreadPool.h"
+#include "Thread/Runnable.h"
+#include "Thread/RunnableThread.h"
+#include "Thread/SingleThreadRunnable.h"
+#include "Thread/TaskGroup.h"
+#include "Thread/TaskPipe.h"
+#include "Thread/ThreadCache.h"
+#include "Thread/ThreadManager.h"
+
+TEST_CASE(TaskPipe_RunsInLaunchOrder)
+{
+	const int32 NumPipes = 8;
+	const int32 NumLaunches = 200;
+	std::vector<FTaskPipe*> Pipes;
+	std::vector<int32> Last(NumPipes, -1);
+	std::atomic<int32> NumOutOfOrder(0);
+	for (int32 Index = 0; Index < NumPipes; ++Index)
+	{
+		Pipes.push_back(new FTaskPipe());
+	}
+	for (int32 Launch = 0; Launch < NumLaunches; ++Launch)
+	{
+		for (int32 Index = 0; Index < NumPipes; ++Index)
+		{
+			Pipes[Index]->Launch([&Last, &NumOutOfOrder, Index, Launch]()
+			{
+				if (Last[Index] != Launch - 1)
+				{
+					++NumOutOfOrder;
+				}
+				Last[Index] = Launch;
+			});
+		}
+	}
+	for (FTaskPipe* Pipe : Pipes)
+	{
+		while (!Pipe->IsEmpty())
+		{
+			FPlatformProcess::Sleep(0.001f);
+		}
+		delete Pipe;
+	}
+	CHECK(NumOutOfOrder == 0);
+	for (int32 Index = 0; Index < NumPipes; ++Index)
+	{
+		CHECK(Last[Index] == NumLaunches - 1);
+	}
+}
+
+static void RunTree(int32 Depth, std::atomic<int32>& NumLeaves)
+{
+	if (Depth == 0)
+	{
+		++NumLeaves;
+		return;
+	}
+	FTaskGroup Group;
+	for (int32 Index = 0; Index < 3; ++Index)
+	{
+		Group.Run([Depth, &NumLeaves]() { RunTree(Depth - 1, NumLeaves); });
+	}
+	Group.Wait();
+}
+
+TEST_CASE(TaskGroup_NestedWaits)
+{
+	std::atomic<int32> NumLeaves(0);
+	RunTree(5, NumLeaves);
+	CHECK(NumLeaves == 243);
+
+	// A group is reusable once waited for, and counts work added by hand
+	FTaskGroup Group;
+	std::atomic<int32> NumRuns(0);
+	for (int32 Round = 0; Round < 20; ++Round)
+	{
+		for (int32 Index = 0; Index < 10; ++Index)
+		{
+			Group.Run([&NumRuns]() { ++NumRuns; });
+		}
+		Group.Wait();
+		CHECK(Group.IsComplete());
+	}
+	CHECK(NumRuns == 200);
+	Group.Add(2);
+	Async([&Group]() { Group.Done(); });
+	Async([&Group]() { Group.Done(); });
+	Group.Wait();
+	CHECK(Group.IsComplete());
+}
+
+static int32 Fibonacci(int32 N, FQueuedThreadPool* ThreadPool)
+{
+	if (N < 2)
+	{
+		return N;
+	}
+	TFuture<int32> A = Async([N, ThreadPool]() { return Fibonacci(N - 1, ThreadPool); }, ThreadPool);
+	TFuture<int32> B = Async([N, ThreadPool]() { return Fibonacci(N - 2, ThreadPool); }, ThreadPool);
+	return A.Get() + B.Get();
+}
+
+TEST_CASE(HelpingWait_RecursiveForkJoin)
+{
+	// Every pool thread ends up waiting, queued work must still run once they all block
+	FQueuedThreadPool* ThreadPool = FQueuedThreadPool::Allocate();
+	ThreadPool->Create(2);
+	const int32 OldMaxHelpDepth = FHelpingWait::MaxHelpDepth;
+	FHelpingWait::MaxHelpDepth = 1;
+	CHECK(Fibonacci(15, ThreadPool) == 610);
+	FHelpingWait::MaxHelpDepth = OldMaxHelpDepth;
+	ThreadPool->Destory();
+	delete ThreadPool;
+}
+
+TEST_CASE(ThreadPool_RejectsWhenFull)
+{
+	FQueuedThreadPool* ThreadPool = FQueuedThreadPool::Allocate();
+	ThreadPool->Create(1);
+	std::atomic<int32> NumRuns(0);
+	{
+		FPoolBlocker Blocker(ThreadPool);
+		ThreadPool->SetQueueCapacity(2, EQueueOverflowPolicy::Reject);
+		CHECK(ThreadPool->QueuedThreadWork(new FFunctionQueuedWork([&NumRuns]() { ++NumRuns; })) == EQueuedWorkResult::Queued);
+		CHECK(ThreadPool->QueuedThreadWork(new FFunctionQueuedWork([&NumRuns]() { ++NumRuns; })) == EQueuedWorkResult::Queued);
+		IQueuedWork* Work = new FFunctionQueuedWork([&NumRuns]() { ++NumRuns; });
+		CHECK(ThreadPool->QueuedThreadWork(Work) == EQueuedWorkResult::Rejected);
+		// Rejected work still belongs to the caller
+		Work->Abandon();
+		CHECK(ThreadPool->GetQueueStats().NumRejected == 1);
+	}
+	ThreadPool->Destory();
+	delete ThreadPool;
+	CHECK(NumRuns == 2);
+}
+
+TEST_CASE(ThreadPool_RunsInlineWhenFull)
+{
+	FQueuedThreadPool* ThreadPool = FQueuedThreadPool::Allocate();
+	ThreadPool->Create(1);
+	{
+		FPoolBlocker Blocker(ThreadPool);
+		ThreadPool->SetQueueCapacity(1, EQueueOverflowPolicy::RunInline);
+		CHECK(ThreadPool->QueuedThreadWork(new FFunctionQueuedWork([]() {})) == EQueuedWorkResult::Queued);
+		uint32 ThreadId = 0;
+		CHECK(ThreadPool->QueuedThreadWork(new FFunctionQueuedWork([&ThreadId]() { ThreadId = FPlatformTLS::GetCurrentThreadId(); })) == EQueuedWorkResult::ExecutedInline);
+		CHECK(ThreadId == FPlatformTLS::GetCurrentThreadId());
+		CHECK(ThreadPool->GetQueueStats().NumExecutedInline == 1);
+	}
+	ThreadPool->Destory();
+	delete ThreadPool;
+}
+
+TEST_CASE(ThreadPool_BlocksWhenFull)
+{
+	FQueuedThreadPool* ThreadPool = FQueuedThreadPool::Allocate();
+	ThreadPool->Create(2);
+	ThreadPool->SetQueueCapacity(4, EQueueOverflowPolicy::Block);
+	std::atomic<int32> NumRuns(0);
+	for (int32 Index = 0; Index < 200; ++Index)
+	{
+		CHECK(ThreadPool->QueuedThreadWork(new FFunctionQueuedWork([&NumRuns]() { SpinFor(0.0001); ++NumRuns; })) == EQueuedWorkResult::Queued);
+	}
+	while (NumRuns < 200)
+	{
+		FPlatformProcess::Sleep(0.001f);
+	}
+	const FQueuedThreadPoolStats Stats = ThreadPool->GetQueueStats();
+	CHECK(Stats.PeakQueueDepth <= 4);
+	CHECK(Stats.NumQueued == 200);
+	ThreadPool->Destory();
+	delete ThreadPool;
+}
+
+TEST_CASE(ThreadPool_DropsOldestButNotPipeWork)
+{
+	FQueuedThreadPool* ThreadPool = FQueuedThreadPool::Allocate();
+	ThreadPool->Create(1);
+	std::atomic<int32> NumPipeRuns(0);
+	{
+		FTaskPipe Pipe(ThreadPool);
+		std::vector<TFuture<void>> Futures;
+		{
+			FPoolBlocker Blocker(ThreadPool);
+			ThreadPool->SetQueueCapacity(2, EQueueOverflowPolicy::DropOldest);
+			for (int32 Index = 0; Index < 3; ++Index)
+			{
+				Pipe.Launch([&NumPipeRuns]() { ++NumPipeRuns; });
+			}
+			for (int32 Index = 0; Index < 4; ++Index)
+			{
+				Futures.push_back(Async([]() {}, ThreadPool));
+			}
+		}
+		int32 NumAbandoned = 0;
+		for (TFuture<void>& Future : Futures)
+		{
+			Future.Wait();
+			NumAbandoned += Future.GetError() == EFutureError::Abandoned ? 1 : 0;
+		}
+		while (!Pipe.IsEmpty())
+		{
+			FPlatformProcess::Sleep(0.001f);
+		}
+		const FQueuedThreadPoolStats Stats = ThreadPool->GetQueueStats();
+		CHECK(NumPipeRuns == 3);
+		CHECK(Stats.NumDropped == (uint64)NumAbandoned);
+		CHECK(Stats.NumDropped != 0);
+	}
+	ThreadPool->Destory();
+	delete ThreadPool;
+}
+
+class FRecordThreadIdRunnable : public FRunnable
+{
+public:
+	FRecordThreadIdRunnable()
+		: ThreadId(0)
+	{}
+
+	virtual int Run() override
+	{
+		ThreadId = FPlatformTLS::GetCurrentThreadId();
+		return 0;
+	}
+
+	uint32 ThreadId;
+};
+
+TEST_CASE(ThreadCache_ReusesParkedThreads)
+{
+	const int32 NumThreads = 20;
+	FThreadCache::Get().SetMaxCachedThreads(4);
+	std::set<uint32> ThreadIds;
+	for (int32 Index = 0; Index < NumThreads; ++Index)
+	{
+		FRecordThreadIdRunnable Runnable;
+		FRunnableThread* Thread = FRunnableThread::Create(&Runnable, TEXT("CachedThread"), 64 * 1024u);
+		CHECK(Thread != nullptr);
+		Thread->WaitForCompletion();
+		delete Thread;
+		ThreadIds.insert(Runnable.ThreadId);
+	}
+	FThreadCache::Get().SetMaxCachedThreads(0);
+	CHECK((int32)ThreadIds.size() < NumThreads / 2);
+}
+
+class FTickCountingRunnable : public FRunnable, public FSingleThreadRunnable
+{
+public:
+	FTickCountingRunnable(int32 InMaxTicks)
+		: NumTicks(0)
+		, MaxTicks(InMaxTicks)
+	{}
+
+	virtual int Run() override
+	{
+		return 0;
+	}
+
+	virtual FSingleThreadRunnable* GetSingleThreadInterface() override
+	{
+		return this;
+	}
+
+	virtual bool Tick() override
+	{
+		if (NumTicks >= MaxTicks)
+		{
+			return false;
+		}
+		++NumTicks;
+		return true;
+	}
+
+	int32 NumTicks;
+	int32 MaxTicks;
+};
+
+TEST_CASE(FakeThreads_AreTicked)
+{
+	FPlatformProcess::SetSupportsMultithreading(false);
+	FQueuedThreadPool* ThreadPool = FQueuedThreadPool::Allocate();
+	ThreadPool->Create(2);
+	CHECK(FThreadManager::Get().HasFakeThreads());
+
+	// Waits tick the fake pool threads, also from work a wait runs
+	TFuture<int32> Future = Async([ThreadPool]()
+	{
+		TFuture<int32> Inner = Async([]() { return 20; }, ThreadPool);
+		return Inner.Get() + 1;
+	}, ThreadPool);
+	CHECK(Future.Get() == 21);
+	{
+		FTaskGroup Group(ThreadPool);
+		std::atomic<int32> NumRuns(0);
+		for (int32 Index = 0; Index < 50; ++Index)
+		{
+			Group.Run([&NumRuns]() { ++NumRuns; });
+		}
+		Group.Wait();
+		CHECK(NumRuns == 50);
+	}
+
+	FTickCountingRunnable Runnable(5);
+	FRunnableThread* Thread = FRunnableThread::Create(&Runnable, TEXT("Ticked"), 0u);
+	CHECK(Thread != nullptr);
+	FThreadManager::Get().Tick();
+	CHECK(Runnable.NumTicks == 1);
+	Thread->WaitForCompletion();
+	CHECK(Runnable.NumTicks == 5);
+	delete Thread;
+
+	ThreadPool->Destory();
+	delete ThreadPool;
+	FPlatformProcess::SetSupportsMultithreading(true);
+	CHECK(!FThreadManager::Get().HasFakeThreads());
+}